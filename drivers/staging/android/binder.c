@@ -695,6 +695,7 @@ static int __binder_update_page_range(struct binder_proc *proc, int allocate,
 	struct vm_struct tmp_area;
 	struct page **page;
 	struct mm_struct *mm;
+	LIST_HEAD(pages);
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: %s pages %pK-%pK\n", proc->pid,
@@ -729,6 +730,9 @@ static int __binder_update_page_range(struct binder_proc *proc, int allocate,
 		goto err_no_vma;
 	}
 
+	/* Whatever this gets, the loop below falls back to alloc_page() */
+	alloc_pages_bulk(GFP_HIGHUSER, (end - start) / PAGE_SIZE, &pages);
+
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		int ret;
 		struct page **page_array_ptr;
@@ -736,7 +740,11 @@ static int __binder_update_page_range(struct binder_proc *proc, int allocate,
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
 
 		BUG_ON(*page);
-		*page = alloc_page(GFP_HIGHUSER);
+		if (!list_empty(&pages)) {
+			*page = list_first_entry(&pages, struct page, lru);
+			list_del(&(*page)->lru);
+		} else
+			*page = alloc_page(GFP_HIGHUSER);
 		if (*page == NULL) {
 			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
 				proc->pid, page_addr);
@@ -765,6 +773,7 @@ static int __binder_update_page_range(struct binder_proc *proc, int allocate,
 		up_write(&mm->mmap_sem);
 		mmput(mm);
 	}
+	free_pages_bulk(&pages);
 	return 0;
 
 free_range:
@@ -777,7 +786,7 @@ free_range:
 err_vm_insert_page_failed:
 		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
 err_map_kernel_failed:
-		__free_page(*page);
+		list_add(&(*page)->lru, &pages);
 		*page = NULL;
 err_alloc_page_failed:
 		;
@@ -787,6 +796,7 @@ err_no_vma:
 		up_write(&mm->mmap_sem);
 		mmput(mm);
 	}
+	free_pages_bulk(&pages);
 	return -ENOMEM;
 }
 
@@ -458,6 +458,7 @@ static int ext4_dx_readdir(struct file *filp,
 		if (!info)
 			return -ENOMEM;
 		filp->private_data = info;
+		ext4_dx_readahead(inode);
 	}
 
 	if (filp->f_pos == EXT4_HTREE_EOF)
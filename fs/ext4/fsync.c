@@ -188,7 +188,9 @@ static int __sync_inode(struct inode *inode, int datasync)
  * What we do is just kick off a commit and wait on it.  This will snapshot the
  * inode to disk.
  *
- * i_mutex lock is held when entering and exiting this function
+ * i_mutex is only held to convert completed unwritten extents (and, without
+ * a journal, to sync the inode); the commit is waited for without it, so
+ * that writers and other fsync callers on this inode can join that commit.
  */
 
 int ext4_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
@@ -207,21 +209,20 @@ int ext4_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 	ret = filemap_write_and_wait_range(inode->i_mapping, start, end);
 	if (ret)
 		return ret;
-	mutex_lock(&inode->i_mutex);
 
 	if (inode->i_sb->s_flags & MS_RDONLY)
 		goto out;
 
+	mutex_lock(&inode->i_mutex);
 	ret = ext4_flush_completed_IO(inode);
-	if (ret < 0)
-		goto out;
-
-	if (!journal) {
+	if (ret >= 0 && !journal) {
 		ret = __sync_inode(inode, datasync);
 		if (!ret && !list_empty(&inode->i_dentry))
 			ret = ext4_sync_parent(inode);
-		goto out;
 	}
+	mutex_unlock(&inode->i_mutex);
+	if (ret < 0 || !journal)
+		goto out;
 
 	/*
 	 * data=writeback,ordered:
@@ -251,7 +252,6 @@ int ext4_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 	if (needs_barrier)
 		blkdev_issue_flush(inode->i_sb->s_bdev, GFP_KERNEL, NULL);
  out:
-	mutex_unlock(&inode->i_mutex);
 	trace_ext4_sync_file_exit(inode, ret);
 	return ret;
 }
@@ -94,6 +94,12 @@ extern u8 mb_enable_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * pick groups for 2^N requests from the largest free order lists
+ * instead of scanning every group
+ */
+#define MB_DEFAULT_OPTIMIZE_SCAN	1
+
 
 struct ext4_free_data {
 	/* this links the free block information from group_info */
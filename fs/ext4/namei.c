@@ -49,6 +49,11 @@
 #define NAMEI_RA_SIZE	     (NAMEI_RA_CHUNKS * NAMEI_RA_BLOCKS)
 #define NAMEI_RA_INDEX(c,b)  (((c) * NAMEI_RA_BLOCKS) + (b))
 
+/*
+ * how many blocks of a cold htree directory to read ahead at once
+ */
+#define DX_DIR_RA_BLOCKS	256
+
 static struct buffer_head *ext4_append(handle_t *handle,
 					struct inode *inode,
 					ext4_lblk_t *block, int *err)
@@ -967,6 +972,48 @@ cleanup_and_exit:
 	return ret;
 }
 
+/*
+ * htree readdir reads every leaf block synchronously, one at a time, in
+ * hash order.  When the root block of a directory is not cached and not
+ * already being read, queue asynchronous reads for the start of the
+ * directory, so that readdir and the lookups that usually follow it
+ * are served from the buffer cache.
+ */
+void ext4_dx_readahead(struct inode *dir)
+{
+	struct blk_plug plug;
+	struct buffer_head *bh;
+	ext4_lblk_t block, nblocks;
+	int err;
+
+	if (!is_dx(dir))
+		return;
+
+	bh = ext4_getblk(NULL, dir, 0, 0, &err);
+	if (!bh)
+		return;
+	if (buffer_uptodate(bh) || buffer_locked(bh)) {
+		brelse(bh);
+		return;
+	}
+	brelse(bh);
+
+	nblocks = dir->i_size >> EXT4_BLOCK_SIZE_BITS(dir->i_sb);
+	if (nblocks > DX_DIR_RA_BLOCKS)
+		nblocks = DX_DIR_RA_BLOCKS;
+
+	blk_start_plug(&plug);
+	for (block = 0; block < nblocks; block++) {
+		bh = ext4_getblk(NULL, dir, block, 0, &err);
+		if (!bh)
+			continue;
+		if (!buffer_uptodate(bh))
+			ll_rw_block(READA | REQ_META | REQ_PRIO, 1, &bh);
+		brelse(bh);
+	}
+	blk_finish_plug(&plug);
+}
+
 static struct buffer_head * ext4_dx_find_entry(struct inode *dir, const struct qstr *d_name,
 		       struct ext4_dir_entry_2 **res_dir, int *err)
 {
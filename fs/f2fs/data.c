@@ -430,6 +430,7 @@ struct page *get_read_data_page(struct inode *inode, pgoff_t index,
 	err = get_dnode_of_data(&dn, index, LOOKUP_NODE);
 	if (err)
 		goto put_err;
+	f2fs_cache_dnode_extent(&dn);
 	f2fs_put_dnode(&dn);
 
 	if (unlikely(dn.data_blkaddr == NULL_ADDR)) {
@@ -458,6 +459,16 @@ got_it:
 
 	fio.new_blkaddr = fio.old_blkaddr = dn.data_blkaddr;
 	fio.page = page;
+
+	/*
+	 * Readahead of GC victim blocks walks consecutive addresses, so
+	 * merge it into one bio; the caller submits it.
+	 */
+	if (rw == READA) {
+		f2fs_submit_page_mbio(&fio);
+		return page;
+	}
+
 	err = f2fs_submit_page_bio(&fio);
 	if (err)
 		goto put_err;
@@ -709,6 +720,9 @@ next_dnode:
 		goto unlock_out;
 	}
 
+	if (!create)
+		f2fs_cache_dnode_extent(&dn);
+
 	prealloc = 0;
 	ofs_in_node = dn.ofs_in_node;
 	end_offset = ADDRS_PER_PAGE(dn.node_page, inode);
@@ -38,6 +38,7 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->hit_rbtree = atomic64_read(&sbi->read_hit_rbtree);
 	si->hit_total = si->hit_largest + si->hit_cached + si->hit_rbtree;
 	si->total_ext = atomic64_read(&sbi->total_hit_ext);
+	si->read_ext = atomic64_read(&sbi->read_ext_node);
 	si->ext_tree = atomic_read(&sbi->total_ext_tree);
 	si->zombie_tree = atomic_read(&sbi->total_zombie_tree);
 	si->ext_node = atomic_read(&sbi->total_ext_node);
@@ -56,6 +57,22 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->overp_segs = overprovision_segments(sbi);
 	si->valid_count = valid_user_blocks(sbi);
 	si->discard_blks = discard_blocks(sbi);
+	if (SM_I(sbi)->cmd_control_info) {
+		struct flush_cmd_control *fcc = SM_I(sbi)->cmd_control_info;
+
+		si->issued_flush = atomic_read(&fcc->issued_flush);
+		si->merged_flush = atomic_read(&fcc->merged_flush);
+	}
+	si->dnode_sets = NM_I(sbi)->dnode_set_cnt;
+	si->dnodes = NM_I(sbi)->dnode_cnt;
+	if (SM_I(sbi)->dcc_info) {
+		struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+
+		si->pending_discard = dcc->nr_pending;
+		si->pending_discard_blks = dcc->pending_blks;
+		si->issued_discard = dcc->issued_cmds;
+		si->issued_discard_blks = dcc->issued_blks;
+	}
 	si->valid_node_count = valid_node_count(sbi);
 	si->valid_inode_count = valid_inode_count(sbi);
 	si->inline_xattr = atomic_read(&sbi->inline_xattr);
@@ -193,11 +210,19 @@ get_cache:
 	if (SM_I(sbi)->cmd_control_info)
 		si->cache_mem += sizeof(struct flush_cmd_control);
 
+	/* build discard thread */
+	if (SM_I(sbi)->dcc_info) {
+		si->cache_mem += sizeof(struct discard_cmd_control);
+		si->cache_mem += SM_I(sbi)->dcc_info->nr_pending *
+						sizeof(struct discard_cmd);
+	}
+
 	/* free nids */
 	si->cache_mem += NM_I(sbi)->fcnt * sizeof(struct free_nid);
 	si->cache_mem += NM_I(sbi)->nat_cnt * sizeof(struct nat_entry);
 	si->cache_mem += NM_I(sbi)->dirty_nat_cnt *
 					sizeof(struct nat_entry_set);
+	si->cache_mem += NM_I(sbi)->dnode_set_cnt * sizeof(struct dnode_set);
 	si->cache_mem += si->inmem_pages * sizeof(struct inmem_pages);
 	for (i = 0; i <= ORPHAN_INO; i++)
 		si->cache_mem += sbi->im[i].ino_num * sizeof(struct ino_entry);
@@ -309,11 +334,21 @@ static int stat_show(struct seq_file *s, void *v)
 				!si->total_ext ? 0 :
 				div64_u64(si->hit_total * 100, si->total_ext),
 				si->hit_total, si->total_ext);
+		seq_printf(s, "  - Miss Count: %llu, Cached on Read: %llu\n",
+				si->total_ext - si->hit_total, si->read_ext);
 		seq_printf(s, "  - Inner Struct Count: tree: %d(%d), node: %d\n",
 				si->ext_tree, si->zombie_tree, si->ext_node);
 		seq_puts(s, "\nBalancing F2FS Async:\n");
 		seq_printf(s, "  - inmem: %4d, wb_bios: %4d\n",
 			   si->inmem_pages, si->wb_bios);
+		seq_printf(s, "  - discard: pending %u (%u blocks), "
+			   "issued %llu (%llu blocks)\n",
+			   si->pending_discard, si->pending_discard_blks,
+			   si->issued_discard, si->issued_discard_blks);
+		seq_printf(s, "  - flush: issued %d, merged %d\n",
+			   si->issued_flush, si->merged_flush);
+		seq_printf(s, "  - fsync dnodes: %4u in files:%4u\n",
+			   si->dnodes, si->dnode_sets);
 		seq_printf(s, "  - nodes: %4d in %4d\n",
 			   si->ndirty_node, si->node_pages);
 		seq_printf(s, "  - dents: %4d in dirs:%4d (%4d)\n",
@@ -405,6 +440,7 @@ int f2fs_build_stats(struct f2fs_sb_info *sbi)
 	atomic64_set(&sbi->read_hit_rbtree, 0);
 	atomic64_set(&sbi->read_hit_largest, 0);
 	atomic64_set(&sbi->read_hit_cached, 0);
+	atomic64_set(&sbi->read_ext_node, 0);
 
 	atomic_set(&sbi->inline_xattr, 0);
 	atomic_set(&sbi->inline_inode, 0);
@@ -539,6 +539,59 @@ static unsigned int f2fs_update_extent_tree_range(struct inode *inode,
 	return !__is_extent_same(&prev, &et->largest);
 }
 
+/*
+ * Cache [fofs, fofs + len) found by a node lookup on the read path, where
+ * @pgofs is the missed offset inside it.  The range is trimmed to what is
+ * not cached yet; unlike updates, nothing is invalidated and the largest
+ * extent is left alone, so that reads never dirty the inode.
+ */
+static void f2fs_insert_extent_tree_range(struct inode *inode, pgoff_t pgofs,
+			pgoff_t fofs, block_t blkaddr, unsigned int len)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct extent_tree *et = F2FS_I(inode)->extent_tree;
+	struct extent_node *en, *prev_en, *next_en;
+	struct rb_node **insert_p, *insert_parent;
+	struct extent_info ei;
+	unsigned int start = fofs, end = fofs + len;
+
+	if (!et)
+		return;
+
+	write_lock(&et->lock);
+
+	if (is_inode_flag_set(inode, FI_NO_EXTENT))
+		goto out;
+
+	en = __lookup_extent_tree_ret(et, pgofs, &prev_en, &next_en,
+					&insert_p, &insert_parent);
+	if (en)
+		goto out;
+
+	if (!insert_p) {
+		insert_p = &et->root.rb_node;
+		insert_parent = NULL;
+	}
+
+	if (prev_en && prev_en->ei.fofs + prev_en->ei.len > start)
+		start = prev_en->ei.fofs + prev_en->ei.len;
+	if (next_en && next_en->ei.fofs < end)
+		end = next_en->ei.fofs;
+
+	set_extent_info(&ei, start, blkaddr + start - fofs, end - start);
+	en = __attach_extent_node(sbi, et, &ei, insert_parent, insert_p);
+	if (!en)
+		goto out;
+
+	spin_lock(&sbi->extent_lock);
+	list_add_tail(&en->list, &sbi->extent_list);
+	et->cached_en = en;
+	spin_unlock(&sbi->extent_lock);
+	stat_inc_read_ext_node(sbi);
+out:
+	write_unlock(&et->lock);
+}
+
 unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 {
 	struct extent_tree *et, *next;
@@ -705,6 +758,40 @@ void f2fs_update_extent_cache(struct dnode_of_data *dn)
 	f2fs_update_extent_tree_range(dn->inode, fofs, blkaddr, 1);
 }
 
+/*
+ * After a miss, cache the run of contiguous blocks in the direct node
+ * around @dn->ofs_in_node, so that the following reads within it do not
+ * need to look the node up again.  @dn->node_page should be locked.
+ */
+void f2fs_cache_dnode_extent(struct dnode_of_data *dn)
+{
+	struct inode *inode = dn->inode;
+	struct page *node_page = dn->node_page;
+	unsigned int ofs = dn->ofs_in_node, start, end, max;
+	pgoff_t fofs;
+	block_t blkaddr;
+
+	if (!f2fs_may_extent_tree(inode))
+		return;
+
+	blkaddr = datablock_addr(node_page, ofs);
+	if (blkaddr == NULL_ADDR || blkaddr == NEW_ADDR)
+		return;
+
+	max = ADDRS_PER_PAGE(node_page, inode);
+	for (start = ofs; start > 0; start--)
+		if (datablock_addr(node_page, start - 1) !=
+					blkaddr - (ofs - start + 1))
+			break;
+	for (end = ofs + 1; end < max; end++)
+		if (datablock_addr(node_page, end) != blkaddr + (end - ofs))
+			break;
+
+	fofs = start_bidx_of_node(ofs_of_node(node_page), inode);
+	f2fs_insert_extent_tree_range(inode, fofs + ofs, fofs + start,
+				blkaddr - (ofs - start), end - start);
+}
+
 void f2fs_update_extent_cache_range(struct dnode_of_data *dn,
 				pgoff_t fofs, block_t blkaddr, unsigned int len)
 
@@ -584,6 +584,13 @@ struct f2fs_nm_info {
 	unsigned int fcnt;		/* the number of free node id */
 	struct mutex build_lock;	/* lock for build free nids */
 
+	/* dirty direct nodes of each file, used by fsync */
+	struct radix_tree_root dnode_set_root;/* root of the dnode set cache */
+	struct list_head dnode_set_list;	/* list of dnode sets */
+	spinlock_t dnode_set_lock;	/* protect dnode sets */
+	unsigned int dnode_set_cnt;	/* the # of dnode sets */
+	unsigned int dnode_cnt;		/* the # of nids in all dnode sets */
+
 	/* for checkpoint */
 	char *nat_bitmap;		/* NAT bitmap pointer */
 	int bitmap_size;		/* bitmap size */
@@ -655,10 +662,47 @@ struct flush_cmd_control {
 	struct task_struct *f2fs_issue_flush;	/* flush thread */
 	wait_queue_head_t flush_wait_queue;	/* waiting queue for wake-up */
 	atomic_t submit_flush;			/* # of issued flushes */
+	atomic_t issued_flush;			/* # of flushes sent to device */
+	atomic_t merged_flush;			/* # of requests merged by thread */
 	struct llist_head issue_list;		/* list for command issue */
 	struct llist_node *dispatch_list;	/* list for command dispatch */
 };
 
+#define DEF_MAX_DISCARD_REQUEST		8	/* discards issued per round */
+#define DEF_MIN_DISCARD_ISSUE_TIME	50	/* 50 ms between rounds */
+#define DEF_MAX_DISCARD_ISSUE_TIME	60000	/* 60 s, if nothing is queued */
+#define DEF_MAX_PENDING_DISCARD		4096	/* issue even when busy */
+
+enum {
+	D_PREP,			/* queued in the rb-tree */
+	D_SUBMIT,		/* sent to the device, on issue_list */
+};
+
+struct discard_cmd {
+	struct rb_node rb_node;		/* rb node located in rb-tree */
+	struct list_head list;		/* node in issue_list when submitted */
+	block_t lstart;			/* start block address of discard */
+	block_t len;			/* # of blocks to be discarded */
+	int state;			/* D_PREP or D_SUBMIT */
+};
+
+struct discard_cmd_control {
+	struct task_struct *f2fs_issue_discard;	/* discard thread */
+	wait_queue_head_t discard_wait_queue;	/* waiting queue for wake-up */
+	wait_queue_head_t issue_wait_queue;	/* waiters of in-flight discard */
+	struct mutex cmd_lock;			/* protects fields below */
+	struct rb_root root;			/* pending discards by address */
+	unsigned int nr_pending;		/* # of pending discard commands */
+	unsigned int pending_blks;		/* # of pending discard blocks */
+	struct list_head issue_list;		/* discards in flight */
+	unsigned long long issued_cmds;		/* # of issued discard commands */
+	unsigned long long issued_blks;		/* # of issued discard blocks */
+	int discard_wake;			/* to wake up discard thread */
+	unsigned int max_discard_blocks;	/* max. blocks per discard */
+	unsigned int max_discard_request;	/* max. discards per round */
+	unsigned int min_discard_interval;	/* interval between rounds */
+};
+
 struct f2fs_sm_info {
 	struct sit_info *sit_info;		/* whole segment information */
 	struct free_segmap_info *free_info;	/* free segment information */
@@ -694,6 +738,8 @@ struct f2fs_sm_info {
 	/* for flush command control */
 	struct flush_cmd_control *cmd_control_info;
 
+	/* for discard command control */
+	struct discard_cmd_control *dcc_info;
 };
 
 /*
@@ -904,6 +950,7 @@ struct f2fs_sb_info {
 	atomic64_t read_hit_rbtree;		/* # of hit rbtree extent node */
 	atomic64_t read_hit_largest;		/* # of hit largest extent node */
 	atomic64_t read_hit_cached;		/* # of hit cached extent node */
+	atomic64_t read_ext_node;		/* # of extent nodes cached on read */
 	atomic_t inline_xattr;			/* # of inline_xattr inodes */
 	atomic_t inline_inode;			/* # of inline_data inodes */
 	atomic_t inline_dir;			/* # of inline_dentry inodes */
@@ -2080,6 +2127,7 @@ void move_node_page(struct page *, int);
 int fsync_node_pages(struct f2fs_sb_info *, struct inode *,
 			struct writeback_control *, bool);
 int sync_node_pages(struct f2fs_sb_info *, struct writeback_control *);
+void prune_fsync_dnodes(struct f2fs_sb_info *);
 void build_free_nids(struct f2fs_sb_info *);
 bool alloc_nid(struct f2fs_sb_info *, nid_t *);
 void alloc_nid_done(struct f2fs_sb_info *, nid_t);
@@ -2107,6 +2155,8 @@ void f2fs_balance_fs_bg(struct f2fs_sb_info *);
 int f2fs_issue_flush(struct f2fs_sb_info *);
 int create_flush_cmd_control(struct f2fs_sb_info *);
 void destroy_flush_cmd_control(struct f2fs_sb_info *);
+int start_discard_thread(struct f2fs_sb_info *);
+void stop_discard_thread(struct f2fs_sb_info *);
 void invalidate_blocks(struct f2fs_sb_info *, block_t);
 bool is_checkpointed_data(struct f2fs_sb_info *, block_t);
 void refresh_sit_entry(struct f2fs_sb_info *, block_t, block_t);
@@ -2220,7 +2270,7 @@ struct f2fs_stat_info {
 	int all_area_segs, sit_area_segs, nat_area_segs, ssa_area_segs;
 	int main_area_segs, main_area_sections, main_area_zones;
 	unsigned long long hit_largest, hit_cached, hit_rbtree;
-	unsigned long long hit_total, total_ext;
+	unsigned long long hit_total, total_ext, read_ext;
 	int ext_tree, zombie_tree, ext_node;
 	int ndirty_node, ndirty_dent, ndirty_meta, ndirty_data, ndirty_imeta;
 	int inmem_pages;
@@ -2230,6 +2280,10 @@ struct f2fs_stat_info {
 	int bg_gc, wb_bios;
 	int inline_xattr, inline_inode, inline_dir, orphans;
 	unsigned int valid_count, valid_node_count, valid_inode_count, discard_blks;
+	unsigned int pending_discard, pending_discard_blks;
+	int issued_flush, merged_flush;
+	unsigned int dnode_sets, dnodes;
+	unsigned long long issued_discard, issued_discard_blks;
 	unsigned int bimodal, avg_vblocks;
 	int util_free, util_valid, util_invalid;
 	int rsvd_segs, overp_segs;
@@ -2264,6 +2318,7 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_inc_rbtree_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_rbtree))
 #define stat_inc_largest_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_largest))
 #define stat_inc_cached_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_cached))
+#define stat_inc_read_ext_node(sbi)	(atomic64_inc(&(sbi)->read_ext_node))
 #define stat_inc_inline_xattr(inode)					\
 	do {								\
 		if (f2fs_has_inline_xattr(inode))			\
@@ -2347,6 +2402,7 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_rbtree_node_hit(sb)
 #define stat_inc_largest_node_hit(sbi)
 #define stat_inc_cached_node_hit(sbi)
+#define stat_inc_read_ext_node(sbi)
 #define stat_inc_inline_xattr(inode)
 #define stat_dec_inline_xattr(inode)
 #define stat_inc_inline_inode(inode)
@@ -2422,6 +2478,7 @@ unsigned int f2fs_destroy_extent_node(struct inode *);
 void f2fs_destroy_extent_tree(struct inode *);
 bool f2fs_lookup_extent_cache(struct inode *, pgoff_t, struct extent_info *);
 void f2fs_update_extent_cache(struct dnode_of_data *);
+void f2fs_cache_dnode_extent(struct dnode_of_data *);
 void f2fs_update_extent_cache_range(struct dnode_of_data *dn,
 						pgoff_t, block_t, unsigned int);
 void init_extent_cache_info(struct f2fs_sb_info *);
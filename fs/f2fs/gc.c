@@ -250,6 +250,67 @@ static inline unsigned int get_gc_cost(struct f2fs_sb_info *sbi,
 		return get_cb_cost(sbi, segno);
 }
 
+/*
+ * Lowest cost-benefit cost a section in @bucket could have, i.e. the cost
+ * of the least utilized section in the bucket at the oldest possible age.
+ */
+static unsigned int get_cb_bound(struct f2fs_sb_info *sbi, unsigned int bucket)
+{
+	unsigned int vblocks = victim_bucket_min_blocks(sbi, bucket);
+	unsigned char u;
+
+	vblocks = vblocks / sbi->segs_per_sec;
+	u = (vblocks * 100) >> sbi->log_blocks_per_seg;
+
+	return UINT_MAX - ((100 * (100 - u) * 100) / (100 + u));
+}
+
+/*
+ * Pick an LFS victim from the victim index.  Buckets are visited from the
+ * least utilized one.  Greedy selection stops at the first bucket that
+ * yields a usable section; cost-benefit selection stops once no section of
+ * the remaining buckets can beat the current candidate.
+ */
+static void get_victim_from_index(struct f2fs_sb_info *sbi,
+			struct victim_sel_policy *p, int gc_type)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int nsearched = 0;
+	unsigned int i;
+
+	for (i = 0; i < NR_VICTIM_BUCKETS; i++) {
+		struct list_head *entry;
+
+		if (p->min_segno != NULL_SEGNO) {
+			if (p->gc_mode == GC_GREEDY)
+				break;
+			if (get_cb_bound(sbi, i) >= p->min_cost)
+				break;
+		}
+
+		list_for_each(entry, &dirty_i->victim_buckets[i]) {
+			unsigned int secno = entry - dirty_i->victim_entries;
+			unsigned int segno = secno * sbi->segs_per_sec;
+			unsigned int cost;
+
+			if (sec_usage_check(sbi, secno))
+				continue;
+			if (gc_type == BG_GC &&
+					test_bit(secno, dirty_i->victim_secmap))
+				continue;
+
+			cost = get_gc_cost(sbi, segno, p);
+			if (p->min_cost > cost) {
+				p->min_segno = segno;
+				p->min_cost = cost;
+			}
+
+			if (++nsearched >= p->max_search)
+				return;
+		}
+	}
+}
+
 static unsigned int count_bits(const unsigned long *addr,
 				unsigned int offset, unsigned int len)
 {
@@ -269,6 +330,8 @@ static unsigned int count_bits(const unsigned long *addr,
  * and it does not remove it from dirty seglist.
  * When it is called from SSR segment selection, it finds a segment
  * which has minimum valid blocks and removes it from dirty seglist.
+ * GC looks victims up in the victim index, while SSR still scans the
+ * per-type dirty bitmap.
  */
 static int get_victim_by_default(struct f2fs_sb_info *sbi,
 		unsigned int *result, int gc_type, int type, char alloc_mode)
@@ -297,6 +360,11 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			goto got_it;
 	}
 
+	if (p.alloc_mode == LFS) {
+		get_victim_from_index(sbi, &p, gc_type);
+		goto found;
+	}
+
 	while (1) {
 		unsigned long cost;
 		unsigned int segno;
@@ -345,6 +413,7 @@ next:
 			break;
 		}
 	}
+found:
 	if (p.min_segno != NULL_SEGNO) {
 got_it:
 		if (p.alloc_mode == LFS) {
@@ -718,7 +787,7 @@ next_step:
 
 		/* stop BG_GC if there is not enough free sections. */
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0, 0))
-			return;
+			goto out;
 
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
@@ -803,8 +872,20 @@ next_step:
 		}
 	}
 
+	/*
+	 * Phase 3 queued reads of the victim blocks into merged bios, since
+	 * they are mostly contiguous; send them before the pages get locked
+	 * for migration.
+	 */
+	if (phase == 3)
+		f2fs_submit_merged_bio(sbi, DATA, READ);
+
 	if (++phase < 5)
 		goto next_step;
+	return;
+out:
+	if (phase == 3)
+		f2fs_submit_merged_bio(sbi, DATA, READ);
 }
 
 static int __get_victim(struct f2fs_sb_info *sbi, unsigned int *victim,
@@ -37,6 +37,7 @@ static inline int __must_check PTR_ERR_OR_ZERO(__force const void *ptr)
 static struct kmem_cache *nat_entry_slab;
 static struct kmem_cache *free_nid_slab;
 static struct kmem_cache *nat_entry_set_slab;
+static struct kmem_cache *dnode_set_slab;
 
 bool available_free_memory(struct f2fs_sb_info *sbi, int type)
 {
@@ -1259,43 +1260,177 @@ release_page:
 	f2fs_put_page(node_page, 0);
 }
 
+static void add_fsync_dnode(struct f2fs_sb_info *sbi, struct page *page)
+{
+	struct f2fs_nm_info *nm_i = NM_I(sbi);
+	struct dnode_set *set, *new = NULL;
+	nid_t ino = ino_of_node(page);
+	nid_t nid = nid_of_node(page);
+
+retry:
+	radix_tree_preload(GFP_NOFS | __GFP_NOFAIL);
+
+	spin_lock(&nm_i->dnode_set_lock);
+	set = radix_tree_lookup(&nm_i->dnode_set_root, ino);
+	if (!set) {
+		if (!new) {
+			spin_unlock(&nm_i->dnode_set_lock);
+			radix_tree_preload_end();
+			new = f2fs_kmem_cache_alloc(dnode_set_slab, GFP_NOFS);
+			goto retry;
+		}
+		if (radix_tree_insert(&nm_i->dnode_set_root, ino, new)) {
+			spin_unlock(&nm_i->dnode_set_lock);
+			radix_tree_preload_end();
+			goto retry;
+		}
+		set = new;
+		new = NULL;
+		INIT_RADIX_TREE(&set->nid_root, GFP_ATOMIC);
+		set->ino = ino;
+		set->nid_cnt = 0;
+		list_add_tail(&set->set_list, &nm_i->dnode_set_list);
+		nm_i->dnode_set_cnt++;
+	}
+
+	if (!radix_tree_lookup(&set->nid_root, nid)) {
+		if (radix_tree_insert(&set->nid_root, nid,
+				(void *)RADIX_TREE_EXCEPTIONAL_ENTRY)) {
+			spin_unlock(&nm_i->dnode_set_lock);
+			radix_tree_preload_end();
+			goto retry;
+		}
+		set->nid_cnt++;
+		nm_i->dnode_cnt++;
+	}
+	spin_unlock(&nm_i->dnode_set_lock);
+	radix_tree_preload_end();
+
+	if (new)
+		kmem_cache_free(dnode_set_slab, new);
+}
+
+static unsigned int __gang_lookup_dnodes(struct dnode_set *set,
+					nid_t start, nid_t *nids)
+{
+	void **slots[DNODEVEC_SIZE];
+	unsigned long indices[DNODEVEC_SIZE];
+	unsigned int i, found;
+
+	found = radix_tree_gang_lookup_slot(&set->nid_root, slots, indices,
+							start, DNODEVEC_SIZE);
+	for (i = 0; i < found; i++)
+		nids[i] = indices[i];
+	return found;
+}
+
+static unsigned int lookup_fsync_dnodes(struct f2fs_sb_info *sbi, nid_t ino,
+					nid_t start, nid_t *nids)
+{
+	struct f2fs_nm_info *nm_i = NM_I(sbi);
+	struct dnode_set *set;
+	unsigned int found = 0;
+
+	spin_lock(&nm_i->dnode_set_lock);
+	set = radix_tree_lookup(&nm_i->dnode_set_root, ino);
+	if (set)
+		found = __gang_lookup_dnodes(set, start, nids);
+	spin_unlock(&nm_i->dnode_set_lock);
+	return found;
+}
+
+static void __del_from_dnode_set(struct f2fs_nm_info *nm_i,
+					struct dnode_set *set, nid_t nid)
+{
+	radix_tree_delete(&set->nid_root, nid);
+	set->nid_cnt--;
+	nm_i->dnode_cnt--;
+}
+
+static void __free_dnode_set(struct f2fs_nm_info *nm_i, struct dnode_set *set)
+{
+	list_del(&set->set_list);
+	radix_tree_delete(&nm_i->dnode_set_root, set->ino);
+	nm_i->dnode_set_cnt--;
+	kmem_cache_free(dnode_set_slab, set);
+}
+
+/*
+ * Forget the nodes which are neither dirty nor under writeback any more.
+ * Called at the end of checkpoint, when most of them became clean.  A
+ * locked page is kept as well: writeback clears the dirty bit before
+ * ->writepage, which may then either start writeback or redirty it.
+ */
+void prune_fsync_dnodes(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_nm_info *nm_i = NM_I(sbi);
+	struct dnode_set *set, *tmp;
+	nid_t nids[DNODEVEC_SIZE];
+	unsigned int i, found;
+	nid_t nid;
+
+	spin_lock(&nm_i->dnode_set_lock);
+	list_for_each_entry_safe(set, tmp, &nm_i->dnode_set_list, set_list) {
+		nid = 0;
+		while ((found = __gang_lookup_dnodes(set, nid, nids))) {
+			nid = nids[found - 1] + 1;
+			for (i = 0; i < found; i++) {
+				struct page *page;
+
+				page = find_get_page(NODE_MAPPING(sbi), nids[i]);
+				if (page && (PageDirty(page) ||
+						PageWriteback(page) ||
+						PageLocked(page))) {
+					put_page(page);
+					continue;
+				}
+				if (page)
+					put_page(page);
+				__del_from_dnode_set(nm_i, set, nids[i]);
+			}
+		}
+		if (!set->nid_cnt)
+			__free_dnode_set(nm_i, set);
+	}
+	spin_unlock(&nm_i->dnode_set_lock);
+}
+
 static struct page *last_fsync_dnode(struct f2fs_sb_info *sbi, nid_t ino)
 {
-	pgoff_t index, end;
-	struct pagevec pvec;
+	nid_t nids[DNODEVEC_SIZE];
 	struct page *last_page = NULL;
+	nid_t index = 0;
+	unsigned int found;
 
-	pagevec_init(&pvec, 0);
-	index = 0;
-	end = ULONG_MAX;
+	while ((found = lookup_fsync_dnodes(sbi, ino, index, nids))) {
+		int i;
 
-	while (index <= end) {
-		int i, nr_pages;
-		nr_pages = pagevec_lookup_tag(&pvec, NODE_MAPPING(sbi), &index,
-				PAGECACHE_TAG_DIRTY,
-				min(end - index, (pgoff_t)PAGEVEC_SIZE-1) + 1);
-		if (nr_pages == 0)
-			break;
+		index = nids[found - 1] + 1;
 
-		for (i = 0; i < nr_pages; i++) {
-			struct page *page = pvec.pages[i];
+		for (i = 0; i < found; i++) {
+			struct page *page;
 
 			if (unlikely(f2fs_cp_error(sbi))) {
 				f2fs_put_page(last_page, 0);
-				pagevec_release(&pvec);
 				return ERR_PTR(-EIO);
 			}
 
-			if (!IS_DNODE(page) || !is_cold_node(page))
+			page = find_get_page(NODE_MAPPING(sbi), nids[i]);
+			if (!page)
 				continue;
-			if (ino_of_node(page) != ino)
+
+			if (!PageDirty(page) || !IS_DNODE(page) ||
+					!is_cold_node(page) ||
+					ino_of_node(page) != ino) {
+				f2fs_put_page(page, 0);
 				continue;
+			}
 
 			lock_page(page);
 
 			if (unlikely(page->mapping != NODE_MAPPING(sbi))) {
 continue_unlock:
-				unlock_page(page);
+				f2fs_put_page(page, 1);
 				continue;
 			}
 			if (ino_of_node(page) != ino)
@@ -1309,11 +1444,9 @@ continue_unlock:
 			if (last_page)
 				f2fs_put_page(last_page, 0);
 
-			get_page(page);
 			last_page = page;
 			unlock_page(page);
 		}
-		pagevec_release(&pvec);
 		cond_resched();
 	}
 	return last_page;
@@ -1322,13 +1455,14 @@ continue_unlock:
 int fsync_node_pages(struct f2fs_sb_info *sbi, struct inode *inode,
 			struct writeback_control *wbc, bool atomic)
 {
-	pgoff_t index, end;
-	struct pagevec pvec;
+	nid_t nids[DNODEVEC_SIZE];
+	nid_t index;
 	int ret = 0;
 	struct page *last_page = NULL;
 	bool marked = false;
 	nid_t ino = inode->i_ino;
 	int nwritten = 0;
+	unsigned int found;
 
 	if (atomic) {
 		last_page = last_fsync_dnode(sbi, ino);
@@ -1336,37 +1470,37 @@ int fsync_node_pages(struct f2fs_sb_info *sbi, struct inode *inode,
 			return PTR_ERR_OR_ZERO(last_page);
 	}
 retry:
-	pagevec_init(&pvec, 0);
 	index = 0;
-	end = ULONG_MAX;
 
-	while (index <= end) {
-		int i, nr_pages;
-		nr_pages = pagevec_lookup_tag(&pvec, NODE_MAPPING(sbi), &index,
-				PAGECACHE_TAG_DIRTY,
-				min(end - index, (pgoff_t)PAGEVEC_SIZE-1) + 1);
-		if (nr_pages == 0)
-			break;
+	while ((found = lookup_fsync_dnodes(sbi, ino, index, nids))) {
+		int i;
 
-		for (i = 0; i < nr_pages; i++) {
-			struct page *page = pvec.pages[i];
+		index = nids[found - 1] + 1;
+
+		for (i = 0; i < found; i++) {
+			struct page *page;
 
 			if (unlikely(f2fs_cp_error(sbi))) {
 				f2fs_put_page(last_page, 0);
-				pagevec_release(&pvec);
 				return -EIO;
 			}
 
-			if (!IS_DNODE(page) || !is_cold_node(page))
+			page = find_get_page(NODE_MAPPING(sbi), nids[i]);
+			if (!page)
 				continue;
-			if (ino_of_node(page) != ino)
+
+			if ((!PageDirty(page) && page != last_page) ||
+					!IS_DNODE(page) || !is_cold_node(page) ||
+					ino_of_node(page) != ino) {
+				f2fs_put_page(page, 0);
 				continue;
+			}
 
 			lock_page(page);
 
 			if (unlikely(page->mapping != NODE_MAPPING(sbi))) {
 continue_unlock:
-				unlock_page(page);
+				f2fs_put_page(page, 1);
 				continue;
 			}
 			if (ino_of_node(page) != ino)
@@ -1400,6 +1534,7 @@ continue_unlock:
 			ret = NODE_MAPPING(sbi)->a_ops->writepage(page, wbc);
 			if (ret) {
 				unlock_page(page);
+				f2fs_put_page(page, 0);
 				f2fs_put_page(last_page, 0);
 				break;
 			} else {
@@ -1407,12 +1542,13 @@ continue_unlock:
 			}
 
 			if (page == last_page) {
-				f2fs_put_page(page, 0);
+				f2fs_put_page(last_page, 0);
 				marked = true;
-				break;
 			}
+			f2fs_put_page(page, 0);
+			if (marked)
+				break;
 		}
-		pagevec_release(&pvec);
 		cond_resched();
 
 		if (ret || marked)
@@ -1539,34 +1675,30 @@ out:
 
 int wait_on_node_pages_writeback(struct f2fs_sb_info *sbi, nid_t ino)
 {
-	pgoff_t index = 0, end = ULONG_MAX;
-	struct pagevec pvec;
+	nid_t nids[DNODEVEC_SIZE];
+	nid_t index = 0;
+	unsigned int found;
 	int ret2 = 0, ret = 0;
 
-	pagevec_init(&pvec, 0);
+	while ((found = lookup_fsync_dnodes(sbi, ino, index, nids))) {
+		int i;
 
-	while (index <= end) {
-		int i, nr_pages;
-		nr_pages = pagevec_lookup_tag(&pvec, NODE_MAPPING(sbi), &index,
-				PAGECACHE_TAG_WRITEBACK,
-				min(end - index, (pgoff_t)PAGEVEC_SIZE-1) + 1);
-		if (nr_pages == 0)
-			break;
+		index = nids[found - 1] + 1;
 
-		for (i = 0; i < nr_pages; i++) {
-			struct page *page = pvec.pages[i];
+		for (i = 0; i < found; i++) {
+			struct page *page;
 
-			/* until radix tree lookup accepts end_index */
-			if (unlikely(page->index > end))
+			page = find_get_page(NODE_MAPPING(sbi), nids[i]);
+			if (!page)
 				continue;
 
-			if (ino && ino_of_node(page) == ino) {
+			if (PageWriteback(page) && ino_of_node(page) == ino) {
 				f2fs_wait_on_page_writeback(page, NODE, true);
 				if (TestClearPageError(page))
 					ret = -EIO;
 			}
+			f2fs_put_page(page, 0);
 		}
-		pagevec_release(&pvec);
 		cond_resched();
 	}
 
@@ -1641,6 +1773,9 @@ static int f2fs_write_node_page(struct page *page,
 
 redirty_out:
 	redirty_page_for_writepage(wbc, page);
+	/* that does not go through f2fs_set_node_page_dirty() */
+	if (IS_DNODE(page) && is_cold_node(page))
+		add_fsync_dnode(sbi, page);
 	return AOP_WRITEPAGE_ACTIVATE;
 }
 
@@ -1682,6 +1817,9 @@ static int f2fs_set_node_page_dirty(struct page *page)
 		SetPageUptodate(page);
 	if (!PageDirty(page)) {
 		f2fs_set_page_dirty_nobuffers(page);
+		/* after the dirty bit, to close a race with pruning */
+		if (IS_DNODE(page) && is_cold_node(page))
+			add_fsync_dnode(F2FS_P_SB(page), page);
 		inc_page_count(F2FS_P_SB(page), F2FS_DIRTY_NODES);
 		SetPagePrivate(page);
 		f2fs_trace_pid(page);
@@ -2295,8 +2433,11 @@ static int init_node_manager(struct f2fs_sb_info *sbi)
 	INIT_RADIX_TREE(&nm_i->nat_root, GFP_NOIO);
 	INIT_RADIX_TREE(&nm_i->nat_set_root, GFP_NOIO);
 	INIT_LIST_HEAD(&nm_i->nat_entries);
+	INIT_RADIX_TREE(&nm_i->dnode_set_root, GFP_ATOMIC);
+	INIT_LIST_HEAD(&nm_i->dnode_set_list);
 
 	mutex_init(&nm_i->build_lock);
+	spin_lock_init(&nm_i->dnode_set_lock);
 	spin_lock_init(&nm_i->free_nid_list_lock);
 	init_rwsem(&nm_i->nat_tree_lock);
 
@@ -2382,6 +2523,22 @@ void destroy_node_manager(struct f2fs_sb_info *sbi)
 	}
 	up_write(&nm_i->nat_tree_lock);
 
+	/* destroy dnode sets */
+	spin_lock(&nm_i->dnode_set_lock);
+	while (!list_empty(&nm_i->dnode_set_list)) {
+		struct dnode_set *set = list_first_entry(&nm_i->dnode_set_list,
+						struct dnode_set, set_list);
+		nid_t nids[DNODEVEC_SIZE];
+		unsigned int idx;
+
+		while ((found = __gang_lookup_dnodes(set, 0, nids)))
+			for (idx = 0; idx < found; idx++)
+				__del_from_dnode_set(nm_i, set, nids[idx]);
+		__free_dnode_set(nm_i, set);
+	}
+	f2fs_bug_on(sbi, nm_i->dnode_cnt);
+	spin_unlock(&nm_i->dnode_set_lock);
+
 	kfree(nm_i->nat_bitmap);
 	sbi->nm_info = NULL;
 	kfree(nm_i);
@@ -2403,8 +2560,15 @@ int __init create_node_manager_caches(void)
 			sizeof(struct nat_entry_set));
 	if (!nat_entry_set_slab)
 		goto destroy_free_nid;
+
+	dnode_set_slab = f2fs_kmem_cache_create("dnode_set",
+			sizeof(struct dnode_set));
+	if (!dnode_set_slab)
+		goto destroy_nat_entry_set;
 	return 0;
 
+destroy_nat_entry_set:
+	kmem_cache_destroy(nat_entry_set_slab);
 destroy_free_nid:
 	kmem_cache_destroy(free_nid_slab);
 destroy_nat_entry:
@@ -2415,6 +2579,7 @@ fail:
 
 void destroy_node_manager_caches(void)
 {
+	kmem_cache_destroy(dnode_set_slab);
 	kmem_cache_destroy(nat_entry_set_slab);
 	kmem_cache_destroy(free_nid_slab);
 	kmem_cache_destroy(nat_entry_slab);
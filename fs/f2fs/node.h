@@ -35,6 +35,9 @@
 #define NATVEC_SIZE	64
 #define SETVEC_SIZE	32
 
+/* vector size for gang look-up from the dirty dnode set of an inode */
+#define DNODEVEC_SIZE	16
+
 /* return value for read_node_page */
 #define LOCKED_PAGE	1
 
@@ -150,6 +153,18 @@ struct nat_entry_set {
 	unsigned int entry_cnt;		/* the # of nat entries in set */
 };
 
+/*
+ * For fsync, every direct node block of a file is remembered by its inode
+ * number once it gets dirty, so that fsync does not need to look over all
+ * the dirty node pages of the filesystem.
+ */
+struct dnode_set {
+	struct list_head set_list;	/* link with other dnode sets */
+	struct radix_tree_root nid_root;/* nids of dirtied direct nodes */
+	nid_t ino;			/* inode number owning the nodes */
+	unsigned int nid_cnt;		/* the # of nids in set */
+};
+
 /*
  * For free nid mangement
  */
@@ -14,6 +14,7 @@
 #include <linux/blkdev.h>
 #include <linux/prefetch.h>
 #include <linux/kthread.h>
+#include <linux/freezer.h>
 #include <linux/swap.h>
 #include <linux/timer.h>
 
@@ -26,6 +27,7 @@
 #define __reverse_ffz(x) __reverse_ffs(~(x))
 
 static struct kmem_cache *discard_entry_slab;
+static struct kmem_cache *discard_cmd_slab;
 static struct kmem_cache *sit_entry_set_slab;
 static struct kmem_cache *inmem_entry_slab;
 
@@ -506,9 +508,12 @@ repeat:
 		bio->bi_bdev = sbi->sb->s_bdev;
 		ret = __submit_bio_wait(WRITE_FLUSH, bio);
 
+		atomic_inc(&fcc->issued_flush);
+
 		llist_for_each_entry_safe(cmd, next,
 					  fcc->dispatch_list, llnode) {
 			cmd->ret = ret;
+			atomic_inc(&fcc->merged_flush);
 			complete(&cmd->wait);
 		}
 		bio_put(bio);
@@ -538,7 +543,10 @@ int f2fs_issue_flush(struct f2fs_sb_info *sbi)
 		if (test_opt(sbi, FLUSH_MERGE)) atomic_inc(&fcc->submit_flush);
 		bio->bi_bdev = sbi->sb->s_bdev;
 		ret = __submit_bio_wait(WRITE_FLUSH, bio);
-		if (test_opt(sbi, FLUSH_MERGE)) atomic_dec(&fcc->submit_flush);
+		if (test_opt(sbi, FLUSH_MERGE)) {
+			atomic_dec(&fcc->submit_flush);
+			atomic_inc(&fcc->issued_flush);
+		}
 		bio_put(bio);
 		return ret;
 	}
@@ -567,6 +575,8 @@ int create_flush_cmd_control(struct f2fs_sb_info *sbi)
 	if (!fcc)
 		return -ENOMEM;
 	atomic_set(&fcc->submit_flush, 0);
+	atomic_set(&fcc->issued_flush, 0);
+	atomic_set(&fcc->merged_flush, 0);
 	init_waitqueue_head(&fcc->flush_wait_queue);
 	init_llist_head(&fcc->issue_list);
 	SM_I(sbi)->cmd_control_info = fcc;
@@ -592,6 +602,30 @@ void destroy_flush_cmd_control(struct f2fs_sb_info *sbi)
 	SM_I(sbi)->cmd_control_info = NULL;
 }
 
+/*
+ * Put the section of @segno into the victim bucket matching its current
+ * number of valid blocks, or take it out if none of its segments is dirty.
+ * Called with seglist_lock held whenever DIRTY state is re-evaluated.
+ */
+static void __update_victim_index(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int secno = GET_SECNO(sbi, segno);
+	unsigned int start = secno * sbi->segs_per_sec;
+	unsigned int end = start + sbi->segs_per_sec;
+	struct list_head *entry = &dirty_i->victim_entries[secno];
+	unsigned int valid_blocks;
+
+	list_del_init(entry);
+
+	if (find_next_bit(dirty_i->dirty_segmap[DIRTY], end, start) >= end)
+		return;
+
+	valid_blocks = get_valid_blocks(sbi, start, sbi->segs_per_sec);
+	list_add_tail(entry,
+		&dirty_i->victim_buckets[victim_bucket(sbi, valid_blocks)]);
+}
+
 static void __locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		enum dirty_type dirty_type)
 {
@@ -614,6 +648,8 @@ static void __locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		}
 		if (!test_and_set_bit(segno, dirty_i->dirty_segmap[t]))
 			dirty_i->nr_dirty[t]++;
+
+		__update_victim_index(sbi, segno);
 	}
 }
 
@@ -635,6 +671,8 @@ static void __remove_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		if (get_valid_blocks(sbi, segno, sbi->segs_per_sec) == 0)
 			clear_bit(GET_SECNO(sbi, segno),
 						dirty_i->victim_secmap);
+
+		__update_victim_index(sbi, segno);
 	}
 }
 
@@ -668,11 +706,9 @@ static void locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno)
 	mutex_unlock(&dirty_i->seglist_lock);
 }
 
-static int f2fs_issue_discard(struct f2fs_sb_info *sbi,
+static void __mark_discarded(struct f2fs_sb_info *sbi,
 				block_t blkstart, block_t blklen)
 {
-	sector_t start = SECTOR_FROM_BLOCK(blkstart);
-	sector_t len = SECTOR_FROM_BLOCK(blklen);
 	struct seg_entry *se;
 	unsigned int offset;
 	block_t i;
@@ -684,10 +720,411 @@ static int f2fs_issue_discard(struct f2fs_sb_info *sbi,
 		if (!f2fs_test_and_set_bit(offset, se->discard_map))
 			sbi->discard_blks--;
 	}
+}
+
+static int __issue_discard(struct f2fs_sb_info *sbi,
+				block_t blkstart, block_t blklen)
+{
+	sector_t start = SECTOR_FROM_BLOCK(blkstart);
+	sector_t len = SECTOR_FROM_BLOCK(blklen);
+
 	trace_f2fs_issue_discard(sbi->sb, blkstart, blklen);
 	return blkdev_issue_discard(sbi->sb->s_bdev, start, len, GFP_NOFS, 0);
 }
 
+static int f2fs_issue_discard(struct f2fs_sb_info *sbi,
+				block_t blkstart, block_t blklen)
+{
+	__mark_discarded(sbi, blkstart, blklen);
+	return __issue_discard(sbi, blkstart, blklen);
+}
+
+/* returns the first pending command which ends after @blkaddr */
+static struct discard_cmd *__lookup_discard_cmd(
+		struct discard_cmd_control *dcc, block_t blkaddr)
+{
+	struct rb_node *node = dcc->root.rb_node;
+	struct discard_cmd *dc, *found = NULL;
+
+	while (node) {
+		dc = rb_entry(node, struct discard_cmd, rb_node);
+		if (dc->lstart + dc->len > blkaddr) {
+			found = dc;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	return found;
+}
+
+static void __detach_discard_cmd(struct discard_cmd_control *dcc,
+						struct discard_cmd *dc)
+{
+	rb_erase(&dc->rb_node, &dcc->root);
+	dcc->nr_pending--;
+}
+
+static void __remove_discard_cmd(struct discard_cmd_control *dcc,
+						struct discard_cmd *dc)
+{
+	__detach_discard_cmd(dcc, dc);
+	kmem_cache_free(discard_cmd_slab, dc);
+}
+
+/*
+ * Queue [lstart, lstart + len) for the discard thread.  Pending commands
+ * never overlap nor touch each other: a new range is merged into its
+ * neighbours so that the device sees as few and as large requests as
+ * possible.
+ */
+static void __insert_discard_cmd(struct discard_cmd_control *dcc,
+					block_t lstart, block_t len)
+{
+	struct rb_node **p = &dcc->root.rb_node;
+	struct rb_node *parent = NULL, *node;
+	struct discard_cmd *dc, *prev = NULL, *next;
+	block_t end = lstart + len, dc_end;
+
+	while (*p) {
+		parent = *p;
+		dc = rb_entry(parent, struct discard_cmd, rb_node);
+		if (lstart < dc->lstart) {
+			p = &parent->rb_left;
+		} else {
+			prev = dc;
+			p = &parent->rb_right;
+		}
+	}
+
+	if (prev && prev->lstart + prev->len >= lstart) {
+		dc = prev;
+		dc_end = dc->lstart + dc->len;
+		if (end <= dc_end)
+			return;
+		dcc->pending_blks += end - dc_end;
+		dc->len = end - dc->lstart;
+	} else {
+		dc = f2fs_kmem_cache_alloc(discard_cmd_slab, GFP_NOFS);
+		dc->lstart = lstart;
+		dc->len = len;
+		dc->state = D_PREP;
+		rb_link_node(&dc->rb_node, parent, p);
+		rb_insert_color(&dc->rb_node, &dcc->root);
+		dcc->nr_pending++;
+		dcc->pending_blks += len;
+	}
+
+	/* absorb the following commands which are covered or adjacent */
+	while ((node = rb_next(&dc->rb_node))) {
+		next = rb_entry(node, struct discard_cmd, rb_node);
+		dc_end = dc->lstart + dc->len;
+		if (next->lstart > dc_end)
+			break;
+
+		if (next->lstart + next->len > dc_end) {
+			dcc->pending_blks -= dc_end - next->lstart;
+			dc->len = next->lstart + next->len - dc->lstart;
+		} else {
+			dcc->pending_blks -= next->len;
+		}
+		__remove_discard_cmd(dcc, next);
+	}
+}
+
+/* drop [start, start + len) from the pending commands */
+static void __punch_discard_cmd(struct discard_cmd_control *dcc,
+					block_t start, block_t len)
+{
+	struct discard_cmd *dc = __lookup_discard_cmd(dcc, start);
+	struct rb_node *node;
+	block_t end = start + len, dc_end;
+
+	while (dc && dc->lstart < end) {
+		node = rb_next(&dc->rb_node);
+		dc_end = dc->lstart + dc->len;
+
+		if (dc->lstart < start && dc_end > end) {
+			dcc->pending_blks -= dc_end - start;
+			dc->len = start - dc->lstart;
+			__insert_discard_cmd(dcc, end, dc_end - end);
+			return;
+		} else if (dc->lstart < start) {
+			dcc->pending_blks -= dc_end - start;
+			dc->len = start - dc->lstart;
+		} else if (dc_end > end) {
+			dcc->pending_blks -= end - dc->lstart;
+			dc->len = dc_end - end;
+			dc->lstart = end;
+		} else {
+			dcc->pending_blks -= dc->len;
+			__remove_discard_cmd(dcc, dc);
+		}
+		dc = node ? rb_entry(node, struct discard_cmd, rb_node) : NULL;
+	}
+}
+
+static bool __discard_issuing(struct discard_cmd_control *dcc,
+						block_t blkaddr)
+{
+	struct discard_cmd *dc;
+	bool issuing = false;
+
+	mutex_lock(&dcc->cmd_lock);
+	list_for_each_entry(dc, &dcc->issue_list, list) {
+		if (dc->lstart <= blkaddr && blkaddr < dc->lstart + dc->len) {
+			issuing = true;
+			break;
+		}
+	}
+	mutex_unlock(&dcc->cmd_lock);
+	return issuing;
+}
+
+/*
+ * The blocks of a segment which becomes a current segment will be written
+ * soon, so any discard still pending for them must be cancelled.  This is
+ * called under curseg_mutex and sentry_lock, so it does not wait for a
+ * discard already in flight: f2fs_wait_discard() does that once a block
+ * has been handed out and those locks are dropped.
+ */
+static void f2fs_cancel_discard(struct f2fs_sb_info *sbi,
+					block_t start, block_t len)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+
+	if (!dcc)
+		return;
+
+	mutex_lock(&dcc->cmd_lock);
+	__punch_discard_cmd(dcc, start, len);
+	mutex_unlock(&dcc->cmd_lock);
+}
+
+/* new data must not reach @blkaddr before a discard covering it did */
+static void f2fs_wait_discard(struct f2fs_sb_info *sbi, block_t blkaddr)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+
+	if (!dcc || list_empty(&dcc->issue_list))
+		return;
+
+	wait_event(dcc->issue_wait_queue, !__discard_issuing(dcc, blkaddr));
+}
+
+static void f2fs_queue_discard(struct f2fs_sb_info *sbi,
+				block_t blkstart, block_t blklen)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+
+	if (!dcc) {
+		f2fs_issue_discard(sbi, blkstart, blklen);
+		return;
+	}
+
+	__mark_discarded(sbi, blkstart, blklen);
+
+	mutex_lock(&dcc->cmd_lock);
+	__insert_discard_cmd(dcc, blkstart, blklen);
+	mutex_unlock(&dcc->cmd_lock);
+}
+
+static void wake_up_discard_thread(struct f2fs_sb_info *sbi)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+
+	if (!dcc || !dcc->nr_pending)
+		return;
+
+	dcc->discard_wake = 1;
+	wake_up_interruptible_all(&dcc->discard_wait_queue);
+}
+
+/*
+ * Issue the lowest pending discard, split to max_discard_blocks, and return
+ * the number of blocks sent down to the device.  Both the discard thread
+ * and a checkpoint or FITRIM drain may be in here at once, so every chunk
+ * sits on issue_list in D_SUBMIT state until its own bio has completed.
+ */
+static block_t __issue_discard_cmd(struct f2fs_sb_info *sbi,
+					struct discard_cmd_control *dcc)
+{
+	struct rb_node *node;
+	struct discard_cmd *dc, *issue;
+	block_t len;
+
+	mutex_lock(&dcc->cmd_lock);
+	node = rb_first(&dcc->root);
+	if (!node) {
+		mutex_unlock(&dcc->cmd_lock);
+		return 0;
+	}
+
+	dc = rb_entry(node, struct discard_cmd, rb_node);
+	len = dc->len;
+	if (dcc->max_discard_blocks && len > dcc->max_discard_blocks)
+		len = dcc->max_discard_blocks;
+
+	if (len == dc->len) {
+		__detach_discard_cmd(dcc, dc);
+		issue = dc;
+	} else {
+		issue = f2fs_kmem_cache_alloc(discard_cmd_slab, GFP_NOFS);
+		issue->lstart = dc->lstart;
+		issue->len = len;
+		dc->lstart += len;
+		dc->len -= len;
+	}
+	issue->state = D_SUBMIT;
+	list_add_tail(&issue->list, &dcc->issue_list);
+	dcc->pending_blks -= len;
+	mutex_unlock(&dcc->cmd_lock);
+
+	__issue_discard(sbi, issue->lstart, len);
+
+	mutex_lock(&dcc->cmd_lock);
+	list_del(&issue->list);
+	dcc->issued_cmds++;
+	dcc->issued_blks += len;
+	mutex_unlock(&dcc->cmd_lock);
+	kmem_cache_free(discard_cmd_slab, issue);
+	wake_up_all(&dcc->issue_wait_queue);
+
+	return len;
+}
+
+static block_t __drain_discard_cmd(struct f2fs_sb_info *sbi)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+	block_t len, total = 0;
+
+	if (!dcc)
+		return 0;
+
+	while ((len = __issue_discard_cmd(sbi, dcc)))
+		total += len;
+	return total;
+}
+
+static int issue_discard_thread(void *data)
+{
+	struct f2fs_sb_info *sbi = data;
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+	wait_queue_head_t *q = &dcc->discard_wait_queue;
+	long wait_ms = DEF_MAX_DISCARD_ISSUE_TIME;
+	unsigned int i;
+
+	set_user_nice(current, 19);
+	set_freezable();
+
+	do {
+		wait_event_interruptible_timeout(*q,
+				kthread_should_stop() || dcc->discard_wake,
+				msecs_to_jiffies(wait_ms));
+		if (try_to_freeze())
+			continue;
+		if (kthread_should_stop())
+			break;
+
+		dcc->discard_wake = 0;
+
+		if (!dcc->nr_pending) {
+			wait_ms = DEF_MAX_DISCARD_ISSUE_TIME;
+			continue;
+		}
+
+		wait_ms = max_t(unsigned int, dcc->min_discard_interval, 1);
+
+		/* stay out of the way of foreground I/O unless piled up */
+		if (!is_idle(sbi) && dcc->nr_pending < DEF_MAX_PENDING_DISCARD)
+			continue;
+
+		for (i = 0; i < dcc->max_discard_request; i++)
+			if (!__issue_discard_cmd(sbi, dcc))
+				break;
+	} while (!kthread_should_stop());
+
+	return 0;
+}
+
+/*
+ * The discard thread is started and stopped on remount, but the command
+ * control stays allocated until the filesystem goes away: writers and the
+ * checkpoint look at dcc_info without any lock that remount could take.
+ */
+int start_discard_thread(struct f2fs_sb_info *sbi)
+{
+	dev_t dev = sbi->sb->s_bdev->bd_dev;
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+	struct task_struct *task;
+
+	if (!dcc || dcc->f2fs_issue_discard)
+		return 0;
+
+	task = kthread_run(issue_discard_thread, sbi,
+				"f2fs_discard-%u:%u", MAJOR(dev), MINOR(dev));
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+	dcc->f2fs_issue_discard = task;
+	return 0;
+}
+
+void stop_discard_thread(struct f2fs_sb_info *sbi)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+
+	if (!dcc || !dcc->f2fs_issue_discard)
+		return;
+	kthread_stop(dcc->f2fs_issue_discard);
+	dcc->f2fs_issue_discard = NULL;
+
+	/* do not leave what was queued to a thread that is gone */
+	__drain_discard_cmd(sbi);
+}
+
+static int create_discard_cmd_control(struct f2fs_sb_info *sbi)
+{
+	struct discard_cmd_control *dcc;
+	int err;
+
+	dcc = kzalloc(sizeof(struct discard_cmd_control), GFP_KERNEL);
+	if (!dcc)
+		return -ENOMEM;
+	init_waitqueue_head(&dcc->discard_wait_queue);
+	init_waitqueue_head(&dcc->issue_wait_queue);
+	mutex_init(&dcc->cmd_lock);
+	dcc->root = RB_ROOT;
+	INIT_LIST_HEAD(&dcc->issue_list);
+	dcc->max_discard_blocks = sbi->blocks_per_seg;
+	dcc->max_discard_request = DEF_MAX_DISCARD_REQUEST;
+	dcc->min_discard_interval = DEF_MIN_DISCARD_ISSUE_TIME;
+	SM_I(sbi)->dcc_info = dcc;
+
+	if (!test_opt(sbi, DISCARD) || f2fs_readonly(sbi->sb))
+		return 0;
+
+	err = start_discard_thread(sbi);
+	if (err) {
+		kfree(dcc);
+		SM_I(sbi)->dcc_info = NULL;
+	}
+	return err;
+}
+
+static void destroy_discard_cmd_control(struct f2fs_sb_info *sbi)
+{
+	struct discard_cmd_control *dcc = SM_I(sbi)->dcc_info;
+
+	if (!dcc)
+		return;
+	stop_discard_thread(sbi);
+
+	/* do not lose what was queued before going away */
+	__drain_discard_cmd(sbi);
+	kfree(dcc);
+	SM_I(sbi)->dcc_info = NULL;
+}
+
 static void __add_discard_entry(struct f2fs_sb_info *sbi,
 		struct cp_control *cpc, struct seg_entry *se,
 		unsigned int start, unsigned int end)
@@ -809,7 +1246,7 @@ void clear_prefree_segments(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 			continue;
 
 		if (!test_opt(sbi, LFS) || sbi->segs_per_sec == 1) {
-			f2fs_issue_discard(sbi, START_BLOCK(sbi, start),
+			f2fs_queue_discard(sbi, START_BLOCK(sbi, start),
 				(end - start) << sbi->log_blocks_per_seg);
 			continue;
 		}
@@ -818,7 +1255,7 @@ next:
 		start_segno = secno * sbi->segs_per_sec;
 		if (!IS_CURSEC(sbi, secno) &&
 			!get_valid_blocks(sbi, start, sbi->segs_per_sec))
-			f2fs_issue_discard(sbi, START_BLOCK(sbi, start_segno),
+			f2fs_queue_discard(sbi, START_BLOCK(sbi, start_segno),
 				sbi->segs_per_sec << sbi->log_blocks_per_seg);
 
 		start = start_segno + sbi->segs_per_sec;
@@ -831,13 +1268,23 @@ next:
 	list_for_each_entry_safe(entry, this, head, list) {
 		if (force && entry->len < cpc->trim_minlen)
 			goto skip;
-		f2fs_issue_discard(sbi, entry->blkaddr, entry->len);
+		/* a current segment may reuse these blocks at any moment */
+		if (force || IS_CURSEG(sbi, GET_SEGNO(sbi, entry->blkaddr)))
+			f2fs_issue_discard(sbi, entry->blkaddr, entry->len);
+		else
+			f2fs_queue_discard(sbi, entry->blkaddr, entry->len);
 		cpc->trimmed += entry->len;
 skip:
 		list_del(&entry->list);
 		SM_I(sbi)->nr_discards -= entry->len;
 		kmem_cache_free(discard_entry_slab, entry);
 	}
+
+	/* fstrim wants everything on the device before it returns */
+	if (force)
+		cpc->trimmed += __drain_discard_cmd(sbi);
+	else
+		wake_up_discard_thread(sbi);
 }
 
 static bool __mark_sit_entry_dirty(struct f2fs_sb_info *sbi, unsigned int segno)
@@ -1167,6 +1614,9 @@ static void reset_curseg(struct f2fs_sb_info *sbi, int type, int modified)
 	curseg->next_blkoff = 0;
 	curseg->next_segno = NULL_SEGNO;
 
+	f2fs_cancel_discard(sbi, START_BLOCK(sbi, curseg->segno),
+						sbi->blocks_per_seg);
+
 	sum_footer = &(curseg->sum_blk->footer);
 	memset(sum_footer, 0, sizeof(struct summary_footer));
 	if (IS_DATASEG(type))
@@ -1499,6 +1949,8 @@ void allocate_data_block(struct f2fs_sb_info *sbi, struct page *page,
 		fill_node_footer_blkaddr(page, NEXT_FREE_BLKADDR(sbi, curseg));
 
 	mutex_unlock(&curseg->curseg_mutex);
+
+	f2fs_wait_discard(sbi, *new_blkaddr);
 }
 
 static void do_write_page(struct f2fs_summary *sum, struct f2fs_io_info *fio)
@@ -2442,10 +2894,29 @@ static int init_victim_secmap(struct f2fs_sb_info *sbi)
 	return 0;
 }
 
+static int init_victim_index(struct f2fs_sb_info *sbi)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int i;
+
+	for (i = 0; i < NR_VICTIM_BUCKETS; i++)
+		INIT_LIST_HEAD(&dirty_i->victim_buckets[i]);
+
+	dirty_i->victim_entries = f2fs_kvzalloc(MAIN_SECS(sbi) *
+				sizeof(struct list_head), GFP_KERNEL);
+	if (!dirty_i->victim_entries)
+		return -ENOMEM;
+
+	for (i = 0; i < MAIN_SECS(sbi); i++)
+		INIT_LIST_HEAD(&dirty_i->victim_entries[i]);
+	return 0;
+}
+
 static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i;
 	unsigned int bitmap_size, i;
+	int err;
 
 	/* allocate memory for dirty segments list information */
 	dirty_i = kzalloc(sizeof(struct dirty_seglist_info), GFP_KERNEL);
@@ -2463,6 +2934,10 @@ static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 			return -ENOMEM;
 	}
 
+	err = init_victim_index(sbi);
+	if (err)
+		return err;
+
 	init_dirty_segmap(sbi);
 	return init_victim_secmap(sbi);
 }
@@ -2558,6 +3033,12 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 		return err;
 
 	init_min_max_mtime(sbi);
+
+	if (f2fs_discard_en(sbi)) {
+		err = create_discard_cmd_control(sbi);
+		if (err)
+			return err;
+	}
 	return 0;
 }
 
@@ -2591,6 +3072,7 @@ static void destroy_dirty_segmap(struct f2fs_sb_info *sbi)
 		discard_dirty_segmap(sbi, i);
 
 	destroy_victim_secmap(sbi);
+	f2fs_kvfree(dirty_i->victim_entries);
 	SM_I(sbi)->dirty_info = NULL;
 	kfree(dirty_i);
 }
@@ -2654,6 +3136,7 @@ void destroy_segment_manager(struct f2fs_sb_info *sbi)
 	if (!sm_info)
 		return;
 	destroy_flush_cmd_control(sbi);
+	destroy_discard_cmd_control(sbi);
 	destroy_dirty_segmap(sbi);
 	destroy_curseg(sbi);
 	destroy_free_segmap(sbi);
@@ -2669,10 +3152,15 @@ int __init create_segment_manager_caches(void)
 	if (!discard_entry_slab)
 		goto fail;
 
+	discard_cmd_slab = f2fs_kmem_cache_create("discard_cmd",
+			sizeof(struct discard_cmd));
+	if (!discard_cmd_slab)
+		goto destory_discard_entry;
+
 	sit_entry_set_slab = f2fs_kmem_cache_create("sit_entry_set",
 			sizeof(struct sit_entry_set));
 	if (!sit_entry_set_slab)
-		goto destory_discard_entry;
+		goto destroy_discard_cmd;
 
 	inmem_entry_slab = f2fs_kmem_cache_create("inmem_page_entry",
 			sizeof(struct inmem_pages));
@@ -2682,6 +3170,8 @@ int __init create_segment_manager_caches(void)
 
 destroy_sit_entry_set:
 	kmem_cache_destroy(sit_entry_set_slab);
+destroy_discard_cmd:
+	kmem_cache_destroy(discard_cmd_slab);
 destory_discard_entry:
 	kmem_cache_destroy(discard_entry_slab);
 fail:
@@ -2691,6 +3181,7 @@ fail:
 void destroy_segment_manager_caches(void)
 {
 	kmem_cache_destroy(sit_entry_set_slab);
+	kmem_cache_destroy(discard_cmd_slab);
 	kmem_cache_destroy(discard_entry_slab);
 	kmem_cache_destroy(inmem_entry_slab);
 }
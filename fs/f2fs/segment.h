@@ -241,12 +241,21 @@ enum dirty_type {
 	NR_DIRTY_TYPE
 };
 
+/*
+ * Dirty sections are also kept in NR_VICTIM_BUCKETS lists ordered by
+ * their number of valid blocks, so that GC can visit the cheapest
+ * victims first instead of scanning the whole dirty bitmap.
+ */
+#define NR_VICTIM_BUCKETS	64
+
 struct dirty_seglist_info {
 	const struct victim_selection *v_ops;	/* victim selction operation */
 	unsigned long *dirty_segmap[NR_DIRTY_TYPE];
 	struct mutex seglist_lock;		/* lock for segment bitmaps */
 	int nr_dirty[NR_DIRTY_TYPE];		/* # of dirty segments */
 	unsigned long *victim_secmap;		/* background GC victims */
+	struct list_head victim_buckets[NR_VICTIM_BUCKETS];
+	struct list_head *victim_entries;	/* per-section bucket links */
 };
 
 /* victim selection function for cleaning and SSR */
@@ -687,6 +696,23 @@ static inline block_t sum_blk_addr(struct f2fs_sb_info *sbi, int base, int type)
 				- (base + 1) + type;
 }
 
+static inline unsigned int victim_bucket(struct f2fs_sb_info *sbi,
+						unsigned int valid_blocks)
+{
+	unsigned int blks_per_sec = sbi->segs_per_sec * sbi->blocks_per_seg;
+
+	return valid_blocks * NR_VICTIM_BUCKETS / (blks_per_sec + 1);
+}
+
+/* the smallest # of valid blocks a section in @bucket can have */
+static inline unsigned int victim_bucket_min_blocks(struct f2fs_sb_info *sbi,
+						unsigned int bucket)
+{
+	unsigned int blks_per_sec = sbi->segs_per_sec * sbi->blocks_per_seg;
+
+	return DIV_ROUND_UP(bucket * (blks_per_sec + 1), NR_VICTIM_BUCKETS);
+}
+
 static inline bool sec_usage_check(struct f2fs_sb_info *sbi, unsigned int secno)
 {
 	if (IS_CURSEC(sbi, secno) || (sbi->cur_victim_sec == secno))
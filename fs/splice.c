@@ -599,6 +599,7 @@ ssize_t default_file_splice_read(struct file *in, loff_t *ppos,
 	size_t this_len;
 	int error;
 	int i;
+	LIST_HEAD(page_list);
 	struct splice_pipe_desc spd = {
 		.pages = pages,
 		.partial = partial,
@@ -626,13 +627,17 @@ ssize_t default_file_splice_read(struct file *in, loff_t *ppos,
 	offset = *ppos & ~PAGE_CACHE_MASK;
 	nr_pages = (len + offset + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
 
+	alloc_pages_bulk(GFP_USER, min(nr_pages, spd.nr_pages_max),
+			 &page_list);
+
 	for (i = 0; i < nr_pages && i < spd.nr_pages_max && len; i++) {
 		struct page *page;
 
-		page = alloc_page(GFP_USER);
 		error = -ENOMEM;
-		if (!page)
+		if (list_empty(&page_list))
 			goto err;
+		page = list_first_entry(&page_list, struct page, lru);
+		list_del(&page->lru);
 
 		this_len = min_t(size_t, len, PAGE_CACHE_SIZE - offset);
 		vec[i].iov_base = (void __user *) page_address(page);
@@ -643,6 +648,8 @@ ssize_t default_file_splice_read(struct file *in, loff_t *ppos,
 		offset = 0;
 	}
 
+	free_pages_bulk(&page_list);
+
 	res = kernel_readv(in, vec, spd.nr_pages, *ppos);
 	if (res < 0) {
 		error = res;
@@ -679,7 +686,8 @@ shrink_ret:
 
 err:
 	for (i = 0; i < spd.nr_pages; i++)
-		__free_page(spd.pages[i]);
+		list_add(&spd.pages[i]->lru, &page_list);
+	free_pages_bulk(&page_list);
 
 	res = error;
 	goto shrink_ret;
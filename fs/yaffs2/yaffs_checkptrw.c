@@ -253,12 +253,35 @@ static int yaffs2_checkpt_flush_buffer(struct yaffs_dev *dev)
 	return 1;
 }
 
+/*
+ * Copy a run of bytes to or from the chunk buffer and fold it into the
+ * running checksum. The stream is moved a chunk-buffer run at a time
+ * rather than byte by byte since tnode and block info records make up
+ * the bulk of a checkpoint.
+ */
+static void yaffs2_checkpt_sum_run(struct yaffs_dev *dev, const u8 *bytes,
+				   int n_bytes)
+{
+	u32 sum = dev->checkpt_sum;
+	u32 xor = dev->checkpt_xor;
+	int i;
+
+	for (i = 0; i < n_bytes; i++) {
+		sum += bytes[i];
+		xor ^= bytes[i];
+	}
+
+	dev->checkpt_sum = sum;
+	dev->checkpt_xor = xor;
+}
+
 int yaffs2_checkpt_wr(struct yaffs_dev *dev, const void *data, int n_bytes)
 {
 	int i = 0;
 	int ok = 1;
+	int run;
 
-	u8 *data_bytes = (u8 *) data;
+	const u8 *data_bytes = (const u8 *)data;
 
 	if (!dev->checkpt_buffer)
 		return 0;
@@ -267,14 +290,18 @@ int yaffs2_checkpt_wr(struct yaffs_dev *dev, const void *data, int n_bytes)
 		return -1;
 
 	while (i < n_bytes && ok) {
-		dev->checkpt_buffer[dev->checkpt_byte_offs] = *data_bytes;
-		dev->checkpt_sum += *data_bytes;
-		dev->checkpt_xor ^= *data_bytes;
+		run = dev->data_bytes_per_chunk - dev->checkpt_byte_offs;
+		if (run > n_bytes - i)
+			run = n_bytes - i;
+
+		memcpy(dev->checkpt_buffer + dev->checkpt_byte_offs,
+		       data_bytes, run);
+		yaffs2_checkpt_sum_run(dev, data_bytes, run);
 
-		dev->checkpt_byte_offs++;
-		i++;
-		data_bytes++;
-		dev->checkpt_byte_count++;
+		dev->checkpt_byte_offs += run;
+		i += run;
+		data_bytes += run;
+		dev->checkpt_byte_count += run;
 
 		if (dev->checkpt_byte_offs < 0 ||
 		    dev->checkpt_byte_offs >= dev->data_bytes_per_chunk)
@@ -288,6 +315,7 @@ int yaffs2_checkpt_rd(struct yaffs_dev *dev, void *data, int n_bytes)
 {
 	int i = 0;
 	int ok = 1;
+	int run;
 	struct yaffs_ext_tags tags;
 
 	int chunk;
@@ -346,14 +374,19 @@ int yaffs2_checkpt_rd(struct yaffs_dev *dev, void *data, int n_bytes)
 		}
 
 		if (ok) {
-			*data_bytes =
-			    dev->checkpt_buffer[dev->checkpt_byte_offs];
-			dev->checkpt_sum += *data_bytes;
-			dev->checkpt_xor ^= *data_bytes;
-			dev->checkpt_byte_offs++;
-			i++;
-			data_bytes++;
-			dev->checkpt_byte_count++;
+			run = dev->data_bytes_per_chunk - dev->checkpt_byte_offs;
+			if (run > n_bytes - i)
+				run = n_bytes - i;
+
+			memcpy(data_bytes,
+			       dev->checkpt_buffer + dev->checkpt_byte_offs,
+			       run);
+			yaffs2_checkpt_sum_run(dev, data_bytes, run);
+
+			dev->checkpt_byte_offs += run;
+			i += run;
+			data_bytes += run;
+			dev->checkpt_byte_count += run;
 		}
 	}
 
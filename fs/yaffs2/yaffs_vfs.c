@@ -84,6 +84,7 @@ static uint32_t YCALCBLOCKS(uint64_t partition_size, uint32_t block_size)
 #include "yportenv.h"
 #include "yaffs_trace.h"
 #include "yaffs_guts.h"
+#include "yaffs_ecc.h"
 #include "yaffs_attribs.h"
 
 #include "yaffs_linux.h"
@@ -2727,6 +2728,12 @@ static int __init init_yaffs_fs(void)
 
 	mutex_init(&yaffs_context_lock);
 
+#ifdef CONFIG_YAFFS_ECC_SELFTEST
+	error = yaffs_ecc_selftest();
+	if (error)
+		return error;
+#endif
+
 	/* Install the proc_fs entries */
 	my_proc_entry = create_proc_entry("yaffs",
 					  S_IRUGO | S_IFREG, YPROC_ROOT);
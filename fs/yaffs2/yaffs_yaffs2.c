@@ -954,6 +954,202 @@ static int yaffs2_ybicmp(const void *a, const void *b)
 		return aseq - bseq;
 }
 
+/*
+ * Tag prefetch for the backward scan.
+ *
+ * Reading the tags of every chunk dominates the scan, while the merge
+ * that follows has to run strictly in descending sequence order. A
+ * helper thread therefore walks the sorted block index ahead of the
+ * scan and reads the tags of up to YAFFS_SCAN_PREFETCH_BLOCKS blocks
+ * into a ring, so that flash reads overlap with building the object
+ * tree. The scan consumes the ring in the same order as before, so the
+ * resulting tree is identical.
+ *
+ * The drivers share per device buffers, so every NAND access made while
+ * the helper runs, reads as well as chunk deletions and erases from the
+ * scan thread, is serialised on io_lock. Chunk error accounting is left
+ * to the scan thread when it consumes the tags.
+ */
+#define YAFFS_SCAN_PREFETCH_BLOCKS	8
+
+struct yaffs_scan_prefetch {
+	struct yaffs_dev *dev;
+	struct yaffs_block_index *block_index;
+	int n_blocks;
+	struct yaffs_ext_tags *tags;
+	int alt_tags;
+	struct mutex io_lock;
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	int produced;
+	int consumed;
+	int stop;
+	struct completion done;
+};
+
+static struct yaffs_ext_tags *yaffs2_prefetch_slot(
+					struct yaffs_scan_prefetch *pf, int k)
+{
+	return pf->tags + (k % YAFFS_SCAN_PREFETCH_BLOCKS) *
+	    pf->dev->param.chunks_per_block;
+}
+
+static int yaffs2_prefetch_thread(void *data)
+{
+	struct yaffs_scan_prefetch *pf = data;
+	struct yaffs_dev *dev = pf->dev;
+	struct yaffs_ext_tags *tags;
+	int k;
+	int c;
+	int chunk;
+
+	for (k = 0; k < pf->n_blocks; k++) {
+		wait_event(pf->wait, pf->stop ||
+			   k < pf->consumed + YAFFS_SCAN_PREFETCH_BLOCKS);
+		if (pf->stop)
+			break;
+
+		tags = yaffs2_prefetch_slot(pf, k);
+		chunk = pf->block_index[pf->n_blocks - 1 - k].block *
+		    dev->param.chunks_per_block;
+
+		for (c = dev->param.chunks_per_block - 1; c >= 0; c--) {
+			mutex_lock(&pf->io_lock);
+			dev->param.read_chunk_tags_fn(dev,
+						      chunk + c -
+						      dev->chunk_offset,
+						      NULL, &tags[c]);
+			mutex_unlock(&pf->io_lock);
+		}
+
+		spin_lock(&pf->lock);
+		pf->produced = k + 1;
+		spin_unlock(&pf->lock);
+		wake_up(&pf->wait);
+	}
+
+	complete(&pf->done);
+	return 0;
+}
+
+static struct yaffs_scan_prefetch *yaffs2_prefetch_start(
+					struct yaffs_dev *dev,
+					struct yaffs_block_index *block_index,
+					int n_blocks)
+{
+	struct yaffs_scan_prefetch *pf;
+	struct task_struct *task;
+	int n_tags;
+
+	if (n_blocks < 2 || !dev->param.read_chunk_tags_fn)
+		return NULL;
+
+	pf = kzalloc(sizeof(struct yaffs_scan_prefetch), GFP_NOFS);
+	if (!pf)
+		return NULL;
+
+	n_tags = YAFFS_SCAN_PREFETCH_BLOCKS * dev->param.chunks_per_block;
+	pf->tags = kmalloc(n_tags * sizeof(struct yaffs_ext_tags), GFP_NOFS);
+	if (!pf->tags) {
+		pf->tags = vmalloc(n_tags * sizeof(struct yaffs_ext_tags));
+		pf->alt_tags = 1;
+	}
+	if (!pf->tags) {
+		kfree(pf);
+		return NULL;
+	}
+
+	pf->dev = dev;
+	pf->block_index = block_index;
+	pf->n_blocks = n_blocks;
+	mutex_init(&pf->io_lock);
+	spin_lock_init(&pf->lock);
+	init_waitqueue_head(&pf->wait);
+	init_completion(&pf->done);
+
+	task = kthread_run(yaffs2_prefetch_thread, pf, "yaffs-scan");
+	if (IS_ERR(task)) {
+		if (pf->alt_tags)
+			vfree(pf->tags);
+		else
+			kfree(pf->tags);
+		kfree(pf);
+		return NULL;
+	}
+
+	return pf;
+}
+
+static void yaffs2_prefetch_stop(struct yaffs_scan_prefetch *pf)
+{
+	if (!pf)
+		return;
+
+	spin_lock(&pf->lock);
+	pf->stop = 1;
+	spin_unlock(&pf->lock);
+	wake_up(&pf->wait);
+	wait_for_completion(&pf->done);
+
+	if (pf->alt_tags)
+		vfree(pf->tags);
+	else
+		kfree(pf->tags);
+	kfree(pf);
+}
+
+/* Wait for the tags of the k'th block in scan order to be read in */
+static struct yaffs_ext_tags *yaffs2_prefetch_get(
+					struct yaffs_scan_prefetch *pf, int k)
+{
+	if (!pf)
+		return NULL;
+
+	wait_event(pf->wait, pf->produced > k);
+	return yaffs2_prefetch_slot(pf, k);
+}
+
+static void yaffs2_prefetch_put(struct yaffs_scan_prefetch *pf, int k)
+{
+	if (!pf)
+		return;
+
+	spin_lock(&pf->lock);
+	pf->consumed = k + 1;
+	spin_unlock(&pf->lock);
+	wake_up(&pf->wait);
+}
+
+static void yaffs2_prefetch_io_lock(struct yaffs_scan_prefetch *pf)
+{
+	if (pf)
+		mutex_lock(&pf->io_lock);
+}
+
+static void yaffs2_prefetch_io_unlock(struct yaffs_scan_prefetch *pf)
+{
+	if (pf)
+		mutex_unlock(&pf->io_lock);
+}
+
+/*
+ * Hand out the prefetched tags for a chunk, doing the accounting that
+ * yaffs_rd_chunk_tags_nand() would have done for a direct read.
+ */
+static void yaffs2_prefetch_tags(struct yaffs_dev *dev,
+				 struct yaffs_ext_tags *blk_tags, int chunk,
+				 struct yaffs_ext_tags *tags)
+{
+	*tags = blk_tags[chunk % dev->param.chunks_per_block];
+
+	dev->n_page_reads++;
+
+	if (tags->ecc_result > YAFFS_ECC_RESULT_NO_ERROR)
+		yaffs_handle_chunk_error(dev,
+					 yaffs_get_block_info(dev,
+						chunk / dev->param.chunks_per_block));
+}
+
 int yaffs2_scan_backwards(struct yaffs_dev *dev)
 {
 	struct yaffs_ext_tags tags;
@@ -986,6 +1182,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	struct yaffs_block_index *block_index = NULL;
 	int alt_block_index = 0;
+	struct yaffs_scan_prefetch *pf;
+	struct yaffs_ext_tags *blk_tags;
 
 	yaffs_trace(YAFFS_TRACE_SCAN,
 		"yaffs2_scan_backwards starts  intstartblk %d intendblk %d...",
@@ -1086,6 +1284,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 	end_iter = n_to_scan - 1;
 	yaffs_trace(YAFFS_TRACE_SCAN_DEBUG, "%d blocks to scan", n_to_scan);
 
+	pf = yaffs2_prefetch_start(dev, block_index, n_to_scan);
+
 	/* For each block.... backwards */
 	for (block_iter = end_iter; !alloc_failed && block_iter >= start_iter;
 	     block_iter--) {
@@ -1102,6 +1302,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 		deleted = 0;
 
+		blk_tags = yaffs2_prefetch_get(pf, end_iter - block_iter);
+
 		/* For each chunk in each block that needs scanning.... */
 		found_chunks = 0;
 		for (c = dev->param.chunks_per_block - 1;
@@ -1114,8 +1316,12 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 			chunk = blk * dev->param.chunks_per_block + c;
 
-			result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL,
-							  &tags);
+			if (blk_tags)
+				yaffs2_prefetch_tags(dev, blk_tags, chunk,
+						     &tags);
+			else
+				result = yaffs_rd_chunk_tags_nand(dev, chunk,
+								  NULL, &tags);
 
 			/* Let's have a good look at this chunk... */
 
@@ -1235,8 +1441,10 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 				} else if (in) {
 					/* This chunk has been invalidated by a resize, or a past file deletion
 					 * so delete the chunk*/
+					yaffs2_prefetch_io_lock(pf);
 					yaffs_chunk_del(dev, chunk, 1,
 							__LINE__);
+					yaffs2_prefetch_io_unlock(pf);
 
 				}
 			} else {
@@ -1276,10 +1484,12 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 					 * living with invalid data until needed.
 					 */
 
+					yaffs2_prefetch_io_lock(pf);
 					result = yaffs_rd_chunk_tags_nand(dev,
 									  chunk,
 									  chunk_data,
 									  NULL);
+					yaffs2_prefetch_io_unlock(pf);
 
 					oh = (struct yaffs_obj_hdr *)chunk_data;
 
@@ -1366,8 +1576,10 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 					}
 					/* Use existing - destroy this one. */
+					yaffs2_prefetch_io_lock(pf);
 					yaffs_chunk_del(dev, chunk, 1,
 							__LINE__);
+					yaffs2_prefetch_io_unlock(pf);
 
 				}
 
@@ -1557,6 +1769,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 		}		/* End of scanning for each chunk */
 
+		yaffs2_prefetch_put(pf, end_iter - block_iter);
+
 		if (state == YAFFS_BLOCK_STATE_NEEDS_SCANNING) {
 			/* If we got this far while scanning, then the block is fully allocated. */
 			state = YAFFS_BLOCK_STATE_FULL;
@@ -1568,11 +1782,15 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 		if (bi->pages_in_use == 0 &&
 		    !bi->has_shrink_hdr &&
 		    bi->block_state == YAFFS_BLOCK_STATE_FULL) {
+			yaffs2_prefetch_io_lock(pf);
 			yaffs_block_became_dirty(dev, blk);
+			yaffs2_prefetch_io_unlock(pf);
 		}
 
 	}
 
+	yaffs2_prefetch_stop(pf);
+
 	yaffs_skip_rest_of_block(dev);
 
 	if (alt_block_index)
@@ -127,10 +127,19 @@ extern void mem_cgroup_replace_page_cache(struct page *oldpage,
 extern int do_swap_account;
 #endif
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LAZY
+extern bool mem_cgroup_in_use;
+#endif
+
 static inline bool mem_cgroup_disabled(void)
 {
 	if (mem_cgroup_subsys.disabled)
 		return true;
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LAZY
+	/* nothing is tracked until the first cgroup below the root exists */
+	if (!mem_cgroup_in_use)
+		return true;
+#endif
 	return false;
 }
 
@@ -1485,6 +1485,9 @@ void page_cache_async_readahead(struct address_space *mapping,
 				unsigned long size);
 
 unsigned long max_sane_readahead(unsigned long nr);
+#ifdef CONFIG_READAHEAD_HISTORY
+extern int sysctl_readahead_history;
+#endif
 unsigned long ra_submit(struct file_ra_state *ra,
 			struct address_space *mapping,
 			struct file *filp);
@@ -48,6 +48,10 @@ static inline void __init page_cgroup_init(void)
 }
 #endif
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LAZY
+extern int page_cgroup_init_lazy(void);
+#endif
+
 struct page_cgroup *lookup_page_cgroup(struct page *page);
 struct page *lookup_cgroup_page(struct page_cgroup *pc);
 
@@ -106,6 +106,15 @@ int kmem_cache_shrink(struct kmem_cache *);
 void kmem_cache_free(struct kmem_cache *, void *);
 unsigned int kmem_cache_size(struct kmem_cache *);
 
+/*
+ * Allocate or free several objects of the same cache in one call, which
+ * is cheaper than as many calls to kmem_cache_alloc() or kmem_cache_free().
+ * kmem_cache_alloc_bulk() returns the number of objects stored in the
+ * array: either all of them or, if one allocation failed, 0.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *, gfp_t, size_t, void **);
+void kmem_cache_free_bulk(struct kmem_cache *, size_t, void **);
+
 /*
  * Please use this macro to create slab caches. Simply specify the
  * name of the structure and maybe some flags that are listed above.
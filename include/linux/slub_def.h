@@ -34,6 +34,10 @@ enum stat_item {
 	DEACTIVATE_REMOTE_FREES,/* Slab contained remotely freed objects */
 	ORDER_FALLBACK,		/* Number of times fallback was necessary */
 	CMPXCHG_DOUBLE_CPU_FAIL,/* Failure of this_cpu_cmpxchg_double */
+	CPU_PARTIAL_ALLOC,	/* Cpu slab taken from the cpu partial list */
+	CPU_PARTIAL_FREE,	/* Freeing moves slab to the cpu partial list */
+	CPU_PARTIAL_NODE,	/* Slab moved from node to cpu partial list */
+	CPU_PARTIAL_DRAIN,	/* Cpu partial list moved to node partial list */
 	NR_SLUB_STAT_ITEMS };
 
 struct kmem_cache_cpu {
@@ -41,6 +45,8 @@ struct kmem_cache_cpu {
 	unsigned long tid;	/* Globally unique transaction id */
 	struct page *page;	/* The slab from which we are allocating */
 	int node;		/* The node of the page (or -1 for debug) */
+	struct list_head partial;	/* Frozen partial slabs of this cpu */
+	int nr_partial;		/* Number of slabs on the partial list */
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
@@ -74,6 +80,7 @@ struct kmem_cache {
 	/* Used for retriving partial slabs etc */
 	unsigned long flags;
 	unsigned long min_partial;
+	unsigned int cpu_partial;	/* Partial slabs kept by each cpu */
 	int size;		/* The size of an object including meta data */
 	int objsize;		/* The size of an object without meta data */
 	int offset;		/* Free pointer offset. */
@@ -0,0 +1,523 @@
+/*
+ * mm/boot_prefetch.c - record the files read during boot and read them
+ * back in one sorted sweep on the next boot.
+ *
+ * Booting with "boot_prefetch=record" makes every readahead that goes to
+ * a block device backed file note the path and page range it read, until
+ * userspace writes "stop" to /proc/boot_prefetch.  Reading that file then
+ * returns the trace in a compact binary format for userspace to store.
+ *
+ * On the next boot, writing the stored trace back to /proc/boot_prefetch
+ * opens the files again, sorts the ranges by the disk block they start
+ * at, and reads them all into the page cache.  The writer blocks until
+ * the reads have been submitted, so init can decide whether to wait for
+ * it or run it in the background.
+ *
+ * Recording and replay are mutually exclusive within a boot: once a
+ * trace has been replayed the files it covered no longer go to disk, so
+ * recording on top of it would produce a trace that misses them.
+ */
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/init.h>
+#include <linux/hash.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/mutex.h>
+#include <linux/blkdev.h>
+#include <linux/dcache.h>
+#include <linux/vmalloc.h>
+#include <linux/proc_fs.h>
+#include <linux/uaccess.h>
+#include <asm/unaligned.h>
+
+#include "internal.h"
+
+/*
+ * On-disk trace layout, all little endian:
+ *
+ *	struct boot_prefetch_header
+ *	nr_files x { __le16 len; char path[len]; }
+ *	nr_ranges x struct boot_prefetch_range
+ */
+#define BOOT_PREFETCH_MAGIC	0x46504242	/* "BBPF" */
+#define BOOT_PREFETCH_VERSION	1
+
+struct boot_prefetch_header {
+	__le32 magic;
+	__le16 version;
+	__le16 nr_files;
+	__le32 nr_ranges;
+	__le32 size;		/* of the whole trace, header included */
+};
+
+struct boot_prefetch_range {
+	__le16 file;
+	__le16 nr;		/* pages */
+	__le32 start;		/* page index */
+};
+
+#define BOOT_PREFETCH_MAX_FILES		4096
+#define BOOT_PREFETCH_MAX_RANGES	32768
+#define BOOT_PREFETCH_MAX_SIZE		(4 << 20)
+#define BOOT_PREFETCH_HASH_BITS		9
+#define BOOT_PREFETCH_PLUG_BATCH	32
+
+struct boot_prefetch_file {
+	struct hlist_node hash;
+	struct inode *inode;	/* lookup key only, no reference held */
+	char *path;
+	unsigned short len;
+};
+
+bool boot_prefetch_recording __read_mostly;
+
+static DEFINE_MUTEX(boot_prefetch_mutex);
+static bool boot_prefetch_record_param __initdata;
+static struct hlist_head *boot_prefetch_hash;
+static struct boot_prefetch_file *bp_files;
+static unsigned int bp_nr_files;
+static struct boot_prefetch_range *bp_ranges;
+static unsigned int bp_nr_ranges;
+
+/* The finished trace, built when recording stops */
+static void *bp_trace;
+static size_t bp_trace_size;
+
+static int __init boot_prefetch_setup(char *str)
+{
+	if (str && !strcmp(str, "record"))
+		boot_prefetch_record_param = true;
+	return 1;
+}
+__setup("boot_prefetch=", boot_prefetch_setup);
+
+static struct boot_prefetch_file *boot_prefetch_file(struct file *filp)
+{
+	struct inode *inode = filp->f_mapping->host;
+	struct hlist_head *head;
+	struct hlist_node *node;
+	struct boot_prefetch_file *f;
+	char *buf, *path;
+	size_t len;
+
+	head = &boot_prefetch_hash[hash_ptr(inode, BOOT_PREFETCH_HASH_BITS)];
+	hlist_for_each_entry(f, node, head, hash)
+		if (f->inode == inode)
+			return f;
+
+	if (bp_nr_files >= BOOT_PREFETCH_MAX_FILES)
+		return NULL;
+	if (d_unlinked(filp->f_path.dentry))
+		return NULL;
+
+	buf = kmalloc(PATH_MAX, GFP_NOFS);
+	if (!buf)
+		return NULL;
+	path = d_path(&filp->f_path, buf, PATH_MAX);
+	if (IS_ERR(path) || *path != '/') {
+		kfree(buf);
+		return NULL;
+	}
+	len = buf + PATH_MAX - 1 - path;
+
+	f = &bp_files[bp_nr_files];
+	f->path = kmemdup(path, len, GFP_NOFS);
+	kfree(buf);
+	if (!f->path)
+		return NULL;
+	f->inode = inode;
+	f->len = len;
+	hlist_add_head(&f->hash, head);
+	bp_nr_files++;
+	return f;
+}
+
+static void boot_prefetch_free_tables(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < bp_nr_files; i++)
+		kfree(bp_files[i].path);
+	vfree(bp_files);
+	vfree(bp_ranges);
+	kfree(boot_prefetch_hash);
+	bp_files = NULL;
+	bp_ranges = NULL;
+	boot_prefetch_hash = NULL;
+	bp_nr_files = bp_nr_ranges = 0;
+}
+
+static void boot_prefetch_free_trace(void)
+{
+	vfree(bp_trace);
+	bp_trace = NULL;
+	bp_trace_size = 0;
+}
+
+/*
+ * Readahead just went to disk for a range of a file: add it to the boot
+ * trace, merging it into the previous range when it continues it.
+ */
+void __boot_prefetch_note(struct file *filp, pgoff_t offset, unsigned long nr)
+{
+	struct inode *inode;
+	struct boot_prefetch_file *f;
+	struct boot_prefetch_range *r;
+	unsigned int idx;
+
+	if (!filp || (u64)offset + nr > U32_MAX)
+		return;
+	inode = filp->f_mapping->host;
+	if (!S_ISREG(inode->i_mode) || !inode->i_sb->s_bdev)
+		return;
+
+	mutex_lock(&boot_prefetch_mutex);
+	if (!boot_prefetch_recording)
+		goto out;
+
+	f = boot_prefetch_file(filp);
+	if (!f)
+		goto out;
+	idx = f - bp_files;
+
+	while (nr) {
+		unsigned long this = min_t(unsigned long, nr, U16_MAX);
+
+		r = bp_nr_ranges ? &bp_ranges[bp_nr_ranges - 1] : NULL;
+		if (r && le16_to_cpu(r->file) == idx &&
+		    le32_to_cpu(r->start) + le16_to_cpu(r->nr) == offset &&
+		    le16_to_cpu(r->nr) + this <= U16_MAX) {
+			le16_add_cpu(&r->nr, this);
+		} else {
+			if (bp_nr_ranges >= BOOT_PREFETCH_MAX_RANGES)
+				break;
+			r = &bp_ranges[bp_nr_ranges++];
+			r->file = cpu_to_le16(idx);
+			r->nr = cpu_to_le16(this);
+			r->start = cpu_to_le32(offset);
+		}
+		offset += this;
+		nr -= this;
+	}
+out:
+	mutex_unlock(&boot_prefetch_mutex);
+}
+
+/*
+ * Stop recording and turn the tables into the trace, or throw both away
+ * when a replay is about to make them stale.
+ */
+static void boot_prefetch_stop(bool keep)
+{
+	struct boot_prefetch_header *hdr;
+	size_t size;
+	unsigned int i;
+	char *p;
+
+	mutex_lock(&boot_prefetch_mutex);
+	if (!keep)
+		boot_prefetch_free_trace();
+	if (!boot_prefetch_recording)
+		goto out;
+	boot_prefetch_recording = false;
+	if (!keep)
+		goto free;
+
+	size = sizeof(*hdr) + bp_nr_ranges * sizeof(*bp_ranges);
+	for (i = 0; i < bp_nr_files; i++)
+		size += sizeof(__le16) + bp_files[i].len;
+
+	hdr = vmalloc(size);
+	if (!hdr) {
+		printk(KERN_WARNING "boot_prefetch: no memory for the trace\n");
+		goto free;
+	}
+	hdr->magic = cpu_to_le32(BOOT_PREFETCH_MAGIC);
+	hdr->version = cpu_to_le16(BOOT_PREFETCH_VERSION);
+	hdr->nr_files = cpu_to_le16(bp_nr_files);
+	hdr->nr_ranges = cpu_to_le32(bp_nr_ranges);
+	hdr->size = cpu_to_le32(size);
+
+	p = (char *)(hdr + 1);
+	for (i = 0; i < bp_nr_files; i++) {
+		put_unaligned_le16(bp_files[i].len, p);
+		memcpy(p + sizeof(__le16), bp_files[i].path, bp_files[i].len);
+		p += sizeof(__le16) + bp_files[i].len;
+	}
+	memcpy(p, bp_ranges, bp_nr_ranges * sizeof(*bp_ranges));
+
+	bp_trace = hdr;
+	bp_trace_size = size;
+	printk(KERN_INFO "boot_prefetch: recorded %u ranges in %u files\n",
+	       bp_nr_ranges, bp_nr_files);
+free:
+	boot_prefetch_free_tables();
+out:
+	mutex_unlock(&boot_prefetch_mutex);
+}
+
+struct boot_prefetch_io {
+	struct file *filp;
+	dev_t dev;
+	sector_t block;
+	pgoff_t start;
+	unsigned long nr;
+};
+
+static int boot_prefetch_cmp(const void *a, const void *b)
+{
+	const struct boot_prefetch_io *x = a, *y = b;
+
+	if (x->dev != y->dev)
+		return x->dev < y->dev ? -1 : 1;
+	if (x->block != y->block)
+		return x->block < y->block ? -1 : 1;
+	return 0;
+}
+
+/* Disk block backing the first page of a range, 0 if unknown */
+static sector_t boot_prefetch_block(struct file *filp, pgoff_t index)
+{
+	struct inode *inode = filp->f_mapping->host;
+
+	if (!filp->f_mapping->a_ops->bmap)
+		return 0;
+	return bmap(inode, (sector_t)index <<
+			   (PAGE_CACHE_SHIFT - inode->i_blkbits));
+}
+
+static int boot_prefetch_replay(const void *trace, size_t size)
+{
+	const struct boot_prefetch_header *hdr = trace;
+	const struct boot_prefetch_range *r;
+	struct boot_prefetch_io *io;
+	struct file **files;
+	struct blk_plug plug;
+	unsigned int nr_files, nr_ranges, nr_io = 0;
+	unsigned long pages = 0;
+	const char *p = (const char *)(hdr + 1);
+	const char *end = (const char *)trace + size;
+	unsigned int i;
+	int ret = -EINVAL;
+
+	nr_files = le16_to_cpu(hdr->nr_files);
+	nr_ranges = le32_to_cpu(hdr->nr_ranges);
+	if (nr_ranges > BOOT_PREFETCH_MAX_RANGES)
+		return -EINVAL;
+	if (!nr_ranges)
+		return 0;
+
+	files = kcalloc(nr_files, sizeof(*files), GFP_KERNEL);
+	io = vmalloc(nr_ranges * sizeof(*io));
+	if (!files || !io) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < nr_files; i++) {
+		unsigned int len;
+		char *path;
+
+		if (end - p < sizeof(__le16))
+			goto out;
+		len = get_unaligned_le16(p);
+		p += sizeof(__le16);
+		if (end - p < len)
+			goto out;
+		path = kstrndup(p, len, GFP_KERNEL);
+		p += len;
+		if (!path) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		files[i] = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+		kfree(path);
+		if (IS_ERR(files[i]))
+			files[i] = NULL;
+	}
+	if (end - p != nr_ranges * sizeof(*r))
+		goto out;
+
+	for (r = (const void *)p; r < (const struct boot_prefetch_range *)end;
+	     r++) {
+		unsigned int idx = le16_to_cpu(r->file);
+		struct file *filp;
+
+		if (idx >= nr_files || !files[idx])
+			continue;
+		filp = files[idx];
+		io[nr_io].filp = filp;
+		io[nr_io].dev = filp->f_mapping->host->i_sb->s_dev;
+		io[nr_io].start = le32_to_cpu(r->start);
+		io[nr_io].nr = le16_to_cpu(r->nr);
+		io[nr_io].block = boot_prefetch_block(filp, io[nr_io].start);
+		nr_io++;
+	}
+	sort(io, nr_io, sizeof(*io), boot_prefetch_cmp, NULL);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr_io; i++) {
+		int err = force_page_cache_readahead(io[i].filp->f_mapping,
+				io[i].filp, io[i].start, io[i].nr);
+
+		if (err > 0)
+			pages += err;
+		if ((i + 1) % BOOT_PREFETCH_PLUG_BATCH == 0) {
+			blk_finish_plug(&plug);
+			cond_resched();
+			blk_start_plug(&plug);
+		}
+	}
+	blk_finish_plug(&plug);
+
+	printk(KERN_INFO "boot_prefetch: read %lu pages in %u ranges\n",
+	       pages, nr_io);
+	ret = 0;
+out:
+	if (files) {
+		for (i = 0; i < nr_files; i++)
+			if (files[i])
+				filp_close(files[i], NULL);
+		kfree(files);
+	}
+	vfree(io);
+	return ret;
+}
+
+/* Trace being written back by userspace, possibly over several writes */
+struct boot_prefetch_load {
+	void *buf;
+	size_t size;
+};
+
+static int boot_prefetch_open(struct inode *inode, struct file *file)
+{
+	struct boot_prefetch_load *load;
+
+	if (!(file->f_mode & FMODE_WRITE))
+		return 0;
+	load = kzalloc(sizeof(*load), GFP_KERNEL);
+	if (!load)
+		return -ENOMEM;
+	file->private_data = load;
+	return 0;
+}
+
+static int boot_prefetch_release(struct inode *inode, struct file *file)
+{
+	struct boot_prefetch_load *load = file->private_data;
+
+	if (load) {
+		vfree(load->buf);
+		kfree(load);
+	}
+	return 0;
+}
+
+static ssize_t boot_prefetch_read(struct file *file, char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	ssize_t ret;
+
+	mutex_lock(&boot_prefetch_mutex);
+	if (boot_prefetch_recording)
+		ret = -EBUSY;
+	else
+		ret = simple_read_from_buffer(buf, count, ppos, bp_trace,
+					      bp_trace_size);
+	mutex_unlock(&boot_prefetch_mutex);
+	return ret;
+}
+
+static ssize_t boot_prefetch_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct boot_prefetch_load *load = file->private_data;
+	ssize_t ret;
+
+	if (*ppos == 0 && count >= 4 && count <= 6) {
+		char cmd[6];
+		size_t len = count;
+
+		if (copy_from_user(cmd, buf, count))
+			return -EFAULT;
+		if (cmd[len - 1] == '\n')
+			len--;
+		if (len == 4 && !memcmp(cmd, "stop", 4)) {
+			boot_prefetch_stop(true);
+			return count;
+		}
+		if (len == 5 && !memcmp(cmd, "clear", 5)) {
+			mutex_lock(&boot_prefetch_mutex);
+			boot_prefetch_free_trace();
+			mutex_unlock(&boot_prefetch_mutex);
+			return count;
+		}
+	}
+
+	if (!load->buf) {
+		struct boot_prefetch_header hdr;
+
+		if (*ppos != 0 || count < sizeof(hdr))
+			return -EINVAL;
+		if (copy_from_user(&hdr, buf, sizeof(hdr)))
+			return -EFAULT;
+		if (le32_to_cpu(hdr.magic) != BOOT_PREFETCH_MAGIC ||
+		    le16_to_cpu(hdr.version) != BOOT_PREFETCH_VERSION ||
+		    le32_to_cpu(hdr.size) < sizeof(hdr) ||
+		    le32_to_cpu(hdr.size) > BOOT_PREFETCH_MAX_SIZE)
+			return -EINVAL;
+		load->size = le32_to_cpu(hdr.size);
+		load->buf = vmalloc(load->size);
+		if (!load->buf)
+			return -ENOMEM;
+	}
+
+	ret = simple_write_to_buffer(load->buf, load->size, ppos, buf, count);
+	if (ret <= 0 || *ppos < load->size)
+		return ret;
+
+	/* The whole trace is in: anything recorded from now on is stale */
+	boot_prefetch_stop(false);
+	if (boot_prefetch_replay(load->buf, load->size) < 0)
+		ret = -EINVAL;
+	vfree(load->buf);
+	load->buf = NULL;
+	return ret;
+}
+
+static const struct file_operations boot_prefetch_fops = {
+	.open		= boot_prefetch_open,
+	.read		= boot_prefetch_read,
+	.write		= boot_prefetch_write,
+	.release	= boot_prefetch_release,
+	.llseek		= default_llseek,
+};
+
+static int __init boot_prefetch_init(void)
+{
+	if (boot_prefetch_record_param) {
+		boot_prefetch_hash = kcalloc(1 << BOOT_PREFETCH_HASH_BITS,
+					     sizeof(*boot_prefetch_hash),
+					     GFP_KERNEL);
+		bp_files = vzalloc(BOOT_PREFETCH_MAX_FILES * sizeof(*bp_files));
+		bp_ranges = vmalloc(BOOT_PREFETCH_MAX_RANGES *
+				    sizeof(*bp_ranges));
+		if (boot_prefetch_hash && bp_files && bp_ranges)
+			boot_prefetch_recording = true;
+		else
+			boot_prefetch_free_tables();
+	}
+	if (!proc_create("boot_prefetch", S_IRUSR | S_IWUSR, NULL,
+			 &boot_prefetch_fops)) {
+		/* nobody could ever stop the recording or read the trace */
+		boot_prefetch_recording = false;
+		boot_prefetch_free_tables();
+		return -ENOMEM;
+	}
+	return 0;
+}
+core_initcall(boot_prefetch_init);
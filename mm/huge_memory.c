@@ -533,12 +533,19 @@ static int __init hugepage_init(void)
 	}
 
 	/*
-	 * By default disable transparent hugepages on smaller systems,
-	 * where the extra memory used could hurt more than TLB overhead
-	 * is likely to save.  The admin can still enable it through /sys.
+	 * By default only honour madvise on smaller systems, where the
+	 * extra memory used could hurt more than TLB overhead is likely
+	 * to save, and let khugepaged collapse only ranges that are mostly
+	 * populated already.  The admin can still change both through /sys.
 	 */
-	if (totalram_pages < (512 << (20 - PAGE_SHIFT)))
-		transparent_hugepage_flags = 0;
+	if (totalram_pages < (512 << (20 - PAGE_SHIFT))) {
+		if (test_and_clear_bit(TRANSPARENT_HUGEPAGE_FLAG,
+				       &transparent_hugepage_flags))
+			set_bit(TRANSPARENT_HUGEPAGE_REQ_MADV_FLAG,
+				&transparent_hugepage_flags);
+	}
+	if (totalram_pages < (2048 << (20 - PAGE_SHIFT)))
+		khugepaged_max_ptes_none = HPAGE_PMD_NR / 8;
 
 	start_khugepaged();
 
@@ -1160,7 +1167,8 @@ static int __split_huge_page_splitting(struct page *page,
 	return ret;
 }
 
-static void __split_huge_page_refcount(struct page *page)
+static void __split_huge_page_refcount(struct page *page,
+				       struct list_head *list)
 {
 	int i;
 	unsigned long head_index = page->index;
@@ -1244,7 +1252,7 @@ static void __split_huge_page_refcount(struct page *page)
 
 		mem_cgroup_split_huge_fixup(page, page_tail);
 
-		lru_add_page_tail(zone, page, page_tail);
+		lru_add_page_tail(zone, page, page_tail, list);
 	}
 	atomic_sub(tail_count, &page->_count);
 	BUG_ON(atomic_read(&page->_count) <= 0);
@@ -1359,7 +1367,8 @@ static int __split_huge_page_map(struct page *page,
 
 /* must be called with anon_vma->root->mutex hold */
 static void __split_huge_page(struct page *page,
-			      struct anon_vma *anon_vma)
+			      struct anon_vma *anon_vma,
+			      struct list_head *list)
 {
 	int mapcount, mapcount2;
 	struct anon_vma_chain *avc;
@@ -1391,7 +1400,7 @@ static void __split_huge_page(struct page *page,
 		       mapcount, page_mapcount(page));
 	BUG_ON(mapcount != page_mapcount(page));
 
-	__split_huge_page_refcount(page);
+	__split_huge_page_refcount(page, list);
 
 	mapcount2 = 0;
 	list_for_each_entry(avc, &anon_vma->head, same_anon_vma) {
@@ -1408,7 +1417,13 @@ static void __split_huge_page(struct page *page,
 	BUG_ON(mapcount != mapcount2);
 }
 
-int split_huge_page(struct page *page)
+/*
+ * Split a hugepage into normal pages.  @list is for page reclaim, which
+ * has isolated the head: the tail pages are then put on @list with a
+ * reference held, as if isolated too, instead of back on the LRU, so
+ * that the whole hugepage goes out to swap in the same pass.
+ */
+int split_huge_page_to_list(struct page *page, struct list_head *list)
 {
 	struct anon_vma *anon_vma;
 	int ret = 1;
@@ -1422,7 +1437,7 @@ int split_huge_page(struct page *page)
 		goto out_unlock;
 
 	BUG_ON(!PageSwapBacked(page));
-	__split_huge_page(page, anon_vma);
+	__split_huge_page(page, anon_vma, list);
 	count_vm_event(THP_SPLIT);
 
 	BUG_ON(PageCompound(page));
@@ -2257,6 +2272,18 @@ static struct page *khugepaged_alloc_hugepage(void)
 }
 #endif
 
+/*
+ * A collapse trades free memory for TLB reach.  Once free memory is down
+ * near the watermarks the hugepage could only come from reclaim, which
+ * on a small system means pushing other pages out to zram, so wait for
+ * better times instead.
+ */
+static bool khugepaged_memory_tight(void)
+{
+	return global_page_state(NR_FREE_PAGES) <
+		totalreserve_pages + 2 * HPAGE_PMD_NR;
+}
+
 static void khugepaged_loop(void)
 {
 	struct page *hpage;
@@ -2265,6 +2292,13 @@ static void khugepaged_loop(void)
 	hpage = NULL;
 #endif
 	while (likely(khugepaged_enabled())) {
+		if (khugepaged_memory_tight()) {
+			khugepaged_alloc_sleep();
+			try_to_freeze();
+			if (unlikely(kthread_should_stop()))
+				break;
+			continue;
+		}
 #ifndef CONFIG_NUMA
 		hpage = khugepaged_alloc_hugepage();
 		if (unlikely(!hpage))
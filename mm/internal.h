@@ -16,6 +16,24 @@
 void free_pgtables(struct mmu_gather *tlb, struct vm_area_struct *start_vma,
 		unsigned long floor, unsigned long ceiling);
 
+#ifdef CONFIG_BOOT_PREFETCH
+extern bool boot_prefetch_recording;
+extern void __boot_prefetch_note(struct file *filp, pgoff_t offset,
+				 unsigned long nr);
+
+static inline void boot_prefetch_note(struct file *filp, pgoff_t offset,
+				      unsigned long nr, int actual)
+{
+	if (unlikely(boot_prefetch_recording) && actual > 0)
+		__boot_prefetch_note(filp, offset, nr);
+}
+#else
+static inline void boot_prefetch_note(struct file *filp, pgoff_t offset,
+				      unsigned long nr, int actual)
+{
+}
+#endif
+
 static inline void set_page_count(struct page *page, int v)
 {
 	atomic_set(&page->_count, v);
@@ -88,7 +106,6 @@ extern unsigned long highest_memmap_pfn;
 /*
  * in mm/vmscan.c:
  */
-extern int isolate_lru_page(struct page *page);
 extern void putback_lru_page(struct page *page);
 
 /*
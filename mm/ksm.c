@@ -192,6 +192,31 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer;
 
+/* Whether to merge empty pages with the zero page instead of a ksm page */
+static bool ksm_use_zero_pages __read_mostly;
+
+/* Checksum of an empty page */
+static u32 zero_checksum __read_mostly;
+
+/* The number of pages merged with the zero page, ever */
+static unsigned long ksm_zero_pages_merged;
+
+/* Whether ksmd should sleep longer while full scans merge little */
+static bool ksm_adaptive_scan;
+
+/*
+ * With adaptive_scan, ksmd sleeps sleep_millisecs << ksm_scan_backoff.
+ * The backoff goes up after a full scan which merged fewer than one page
+ * in KSM_YIELD_LOW of those it scanned, and back to 0 after one which
+ * merged at least one in KSM_YIELD_HIGH.
+ */
+#define KSM_MAX_BACKOFF	5
+#define KSM_YIELD_LOW	1000
+#define KSM_YIELD_HIGH	100
+static unsigned int ksm_scan_backoff;
+static unsigned long ksm_scan_pages;
+static long ksm_scan_saved;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -672,11 +697,24 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * The checksum only tells whether a page changed since the last scan, and
+ * whether it might be empty: pages are always compared in full before they
+ * are merged.  So hash the first KSM_CHECKSUM_SAMPLE bytes of every
+ * KSM_CHECKSUM_STRIDE, a quarter of the page, rather than all of it.
+ */
+#define KSM_CHECKSUM_STRIDE	512
+#define KSM_CHECKSUM_SAMPLE	128
+
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
+	u32 checksum = 17;
 	void *addr = kmap_atomic(page, KM_USER0);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	unsigned int offset;
+
+	for (offset = 0; offset < PAGE_SIZE; offset += KSM_CHECKSUM_STRIDE)
+		checksum = jhash2(addr + offset, KSM_CHECKSUM_SAMPLE / 4,
+				  checksum);
 	kunmap_atomic(addr, KM_USER0);
 	return checksum;
 }
@@ -759,7 +797,7 @@ out:
  * replace_page - replace page in vma by new ksm page
  * @vma:      vma that holds the pte pointing to page
  * @page:     the page we are replacing by kpage
- * @kpage:    the ksm page we replace page by
+ * @kpage:    the ksm page we replace page by, or the zero page
  * @orig_pte: the original value of the pte
  *
  * Returns 0 on success, -EFAULT on failure.
@@ -774,6 +812,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pte_t *ptep;
 	spinlock_t *ptl;
 	unsigned long addr;
+	pte_t newpte;
 	int err = -EFAULT;
 
 	addr = page_address_in_vma(page, vma);
@@ -799,12 +838,20 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	if (kpage != ZERO_PAGE(addr)) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		/* Mapped like do_anonymous_page() maps it on a read fault */
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -946,6 +993,38 @@ out:
 	return err;
 }
 
+/*
+ * try_to_merge_zero_page - map the zero page in place of an empty page,
+ * without going through the stable or unstable tree.
+ *
+ * This function returns 0 if the page was merged, -EFAULT otherwise.
+ */
+static int try_to_merge_zero_page(struct rmap_item *rmap_item,
+				  struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address)
+		goto out;
+	/* The zero page cannot take over the mlock of the page it replaces */
+	if (vma->vm_flags & VM_LOCKED)
+		goto out;
+
+	err = try_to_merge_one_page(vma, page,
+				    ZERO_PAGE(rmap_item->address));
+	if (!err)
+		ksm_zero_pages_merged++;
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * try_to_merge_two_pages - take two identical pages and prepare them
  * to be merged into one page.
@@ -1211,6 +1290,14 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 		return;
 	}
 
+	/*
+	 * A page which looks empty is merged with the zero page, and never
+	 * reaches the trees.  If it was not really empty, carry on as usual.
+	 */
+	if (ksm_use_zero_pages && checksum == zero_checksum &&
+	    !try_to_merge_zero_page(rmap_item, page))
+		return;
+
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
 	if (tree_rmap_item) {
@@ -1247,6 +1334,29 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	}
 }
 
+/*
+ * Called at the end of each full scan: with adaptive_scan, back off while
+ * the pages saved by the scan are few compared with the pages it scanned.
+ */
+static void ksm_scan_adjust(void)
+{
+	long saved = ksm_pages_sharing + ksm_zero_pages_merged;
+	long merged = saved - ksm_scan_saved;
+
+	if (!ksm_adaptive_scan)
+		ksm_scan_backoff = 0;
+	else if (merged <= 0 || merged * KSM_YIELD_LOW < ksm_scan_pages) {
+		if (ksm_scan_backoff < KSM_MAX_BACKOFF)
+			ksm_scan_backoff++;
+	} else if (merged * KSM_YIELD_HIGH >= ksm_scan_pages)
+		ksm_scan_backoff = 0;
+	else if (ksm_scan_backoff)
+		ksm_scan_backoff--;
+
+	ksm_scan_saved = saved;
+	ksm_scan_pages = 0;
+}
+
 static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 					    struct rmap_item **rmap_list,
 					    unsigned long addr)
@@ -1403,6 +1513,7 @@ next_mm:
 		goto next_mm;
 
 	ksm_scan.seqnr++;
+	ksm_scan_adjust();
 	return NULL;
 }
 
@@ -1420,6 +1531,7 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
+		ksm_scan_pages++;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
@@ -1468,6 +1580,8 @@ static int ksmd_should_run(void)
 
 static int ksm_scan_thread(void *nothing)
 {
+	unsigned long sleep;
+
 	set_freezable();
 	set_user_nice(current, 5);
 
@@ -1480,12 +1594,12 @@ static int ksm_scan_thread(void *nothing)
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
+			sleep = msecs_to_jiffies(ksm_thread_sleep_millisecs) <<
+							ksm_scan_backoff;
 			if (use_deferred_timer)
-				deferred_schedule_timeout(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				deferred_schedule_timeout(sleep);
 			else
-				schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				schedule_timeout_interruptible(sleep);
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1983,6 +2097,54 @@ static ssize_t deferred_timer_store(struct kobject *kobj,
 }
 KSM_ATTR(deferred_timer);
 
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = strict_strtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = enable;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
+static ssize_t adaptive_scan_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive_scan);
+}
+
+static ssize_t adaptive_scan_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = strict_strtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_adaptive_scan = enable;
+	if (!enable)
+		ksm_scan_backoff = 0;
+
+	return count;
+}
+KSM_ATTR(adaptive_scan);
+
 static ssize_t pages_shared_show(struct kobject *kobj,
 				 struct kobj_attribute *attr, char *buf)
 {
@@ -2028,6 +2190,20 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
+static ssize_t scan_backoff_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_scan_backoff);
+}
+KSM_ATTR_RO(scan_backoff);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -2038,6 +2214,10 @@ static struct attribute *ksm_attrs[] = {
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
 	&deferred_timer_attr.attr,
+	&use_zero_pages_attr.attr,
+	&zero_pages_merged_attr.attr,
+	&adaptive_scan_attr.attr,
+	&scan_backoff_attr.attr,
 	NULL,
 };
 
@@ -2052,6 +2232,9 @@ static int __init ksm_init(void)
 	struct task_struct *ksm_thread;
 	int err;
 
+	/* The checksum of an empty page, for use_zero_pages */
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	err = ksm_slab_init();
 	if (err)
 		goto out;
@@ -49,6 +49,7 @@
 #include <linux/page_cgroup.h>
 #include <linux/cpu.h>
 #include <linux/oom.h>
+#include <linux/vmpressure.h>
 #include "internal.h"
 
 #include <asm/uaccess.h>
@@ -136,6 +137,8 @@ struct mem_cgroup_per_zone {
 	unsigned long long	usage_in_excess;/* Set to the value by which */
 						/* the soft limit is exceeded*/
 	bool			on_tree;
+	bool			background;	/* copy of mem->background */
+						/* under the tree lock	   */
 	struct mem_cgroup	*mem;		/* Back pointer, we cannot */
 						/* use container_of	   */
 };
@@ -246,6 +249,11 @@ struct mem_cgroup {
 	 * Should the accounting and control be hierarchical, per subtree?
 	 */
 	bool use_hierarchy;
+	/*
+	 * Reclaim from this group before any foreground one once it is
+	 * over its soft limit.
+	 */
+	bool background;
 	atomic_t	oom_lock;
 	atomic_t	refcnt;
 
@@ -268,6 +276,9 @@ struct mem_cgroup {
 	/* For oom notifier event fd */
 	struct list_head oom_notify;
 
+	/* For memory.pressure_level notifications */
+	struct vmpressure vmpressure;
+
 	/*
 	 * Should we move charges of a task when a task is moved into this
 	 * mem_cgroup ? And what type of charges should we move ?
@@ -420,7 +431,17 @@ __mem_cgroup_insert_exceeded(struct mem_cgroup *mem,
 		parent = *p;
 		mz_node = rb_entry(parent, struct mem_cgroup_per_zone,
 					tree_node);
-		if (mz->usage_in_excess < mz_node->usage_in_excess)
+		/*
+		 * Background groups sort above all others, so that soft
+		 * limit reclaim, which starts from the rightmost node,
+		 * takes from them first.
+		 */
+		if (mz->background != mz_node->background) {
+			if (mz->background)
+				p = &(*p)->rb_right;
+			else
+				p = &(*p)->rb_left;
+		} else if (mz->usage_in_excess < mz_node->usage_in_excess)
 			p = &(*p)->rb_left;
 		/*
 		 * We can't avoid mem cgroups that are over their soft
@@ -506,6 +527,33 @@ static void mem_cgroup_remove_from_trees(struct mem_cgroup *mem)
 	}
 }
 
+/* Re-sort the group in every tree after its background flag changed */
+static void mem_cgroup_set_background(struct mem_cgroup *mem, bool background)
+{
+	unsigned long long excess;
+	int node, zone;
+	struct mem_cgroup_per_zone *mz;
+	struct mem_cgroup_tree_per_zone *mctz;
+
+	mem->background = background;
+	excess = res_counter_soft_limit_excess(&mem->res);
+	for_each_node_state(node, N_POSSIBLE) {
+		for (zone = 0; zone < MAX_NR_ZONES; zone++) {
+			mz = mem_cgroup_zoneinfo(mem, node, zone);
+			mctz = soft_limit_tree_node_zone(node, zone);
+			spin_lock(&mctz->lock);
+			if (mz->on_tree) {
+				__mem_cgroup_remove_exceeded(mem, mz, mctz);
+				mz->background = background;
+				__mem_cgroup_insert_exceeded(mem, mz, mctz,
+							     excess);
+			} else
+				mz->background = background;
+			spin_unlock(&mctz->lock);
+		}
+	}
+}
+
 static struct mem_cgroup_per_zone *
 __mem_cgroup_largest_soft_limit_node(struct mem_cgroup_tree_per_zone *mctz)
 {
@@ -2078,6 +2126,27 @@ static void refill_stock(struct mem_cgroup *mem, unsigned int nr_pages)
 	put_cpu_var(memcg_stock);
 }
 
+/*
+ * Keep the charge of one freed page in the local stock, if the stock
+ * already holds charges of this memcg, so that the next charge on this
+ * cpu does not have to touch res_counter either.  The stock never grows
+ * past CHARGE_BATCH this way, so usage is off by no more than it already
+ * is because of the charge side.
+ */
+static bool uncharge_to_stock(struct mem_cgroup *mem)
+{
+	struct memcg_stock_pcp *stock;
+	bool ret = false;
+
+	stock = &get_cpu_var(memcg_stock);
+	if (stock->cached == mem && stock->nr_pages < CHARGE_BATCH) {
+		stock->nr_pages++;
+		ret = true;
+	}
+	put_cpu_var(memcg_stock);
+	return ret;
+}
+
 /*
  * Tries to drain stocked charges in other cpus. This function is asynchronous
  * and just put a work per cpu for draining localy on each cpu. Caller can
@@ -2968,9 +3037,12 @@ static void mem_cgroup_do_uncharge(struct mem_cgroup *mem,
 	 * because we want to do uncharge as soon as possible.
 	 */
 
-	if (!batch->do_batch || test_thread_flag(TIF_MEMDIE))
+	if (test_thread_flag(TIF_MEMDIE))
 		goto direct_uncharge;
 
+	if (!batch->do_batch)
+		goto stock_uncharge;
+
 	if (nr_pages > 1)
 		goto direct_uncharge;
 
@@ -2980,12 +3052,20 @@ static void mem_cgroup_do_uncharge(struct mem_cgroup *mem,
 	 * If not, we uncharge res_counter ony by one.
 	 */
 	if (batch->memcg != mem)
-		goto direct_uncharge;
+		goto stock_uncharge;
 	/* remember freed charge and uncharge it later */
 	batch->nr_pages++;
 	if (uncharge_memsw)
 		batch->memsw_nr_pages++;
 	return;
+stock_uncharge:
+	/*
+	 * The stock holds charges of both res and memsw.  Under OOM the
+	 * charge must go back now, for memcg_oom_recover() to wake waiters.
+	 */
+	if (nr_pages == 1 && (uncharge_memsw || !do_swap_account) &&
+	    !atomic_read(&mem->oom_lock) && uncharge_to_stock(mem))
+		return;
 direct_uncharge:
 	res_counter_uncharge(&mem->res, nr_pages * PAGE_SIZE);
 	if (uncharge_memsw)
@@ -4365,6 +4445,23 @@ static int mem_cgroup_swappiness_write(struct cgroup *cgrp, struct cftype *cft,
 	return 0;
 }
 
+static u64 mem_cgroup_background_read(struct cgroup *cgrp, struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cgrp)->background;
+}
+
+static int mem_cgroup_background_write(struct cgroup *cgrp, struct cftype *cft,
+				       u64 val)
+{
+	if (val > 1)
+		return -EINVAL;
+
+	cgroup_lock();
+	mem_cgroup_set_background(mem_cgroup_from_cont(cgrp), val);
+	cgroup_unlock();
+	return 0;
+}
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -4783,6 +4880,11 @@ static struct cftype mem_cgroup_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "soft_limit_background",
+		.read_u64 = mem_cgroup_background_read,
+		.write_u64 = mem_cgroup_background_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -4796,6 +4898,11 @@ static struct cftype mem_cgroup_files[] = {
 		.unregister_event = mem_cgroup_oom_unregister_event,
 		.private = MEMFILE_PRIVATE(_OOM_TYPE, OOM_CONTROL),
 	},
+	{
+		.name = "pressure_level",
+		.register_event = vmpressure_register_event,
+		.unregister_event = vmpressure_unregister_event,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -4971,6 +5078,34 @@ static struct mem_cgroup *parent_mem_cgroup(struct mem_cgroup *mem)
 	return mem_cgroup_from_res_counter(mem->res.parent, res);
 }
 
+/* NULL means global reclaim, which is reported against the root */
+struct vmpressure *memcg_to_vmpressure(struct mem_cgroup *memcg)
+{
+	if (mem_cgroup_subsys.disabled)
+		return NULL;
+	if (!memcg)
+		memcg = root_mem_cgroup;
+	if (!memcg)
+		return NULL;
+	return &memcg->vmpressure;
+}
+
+struct vmpressure *cg_to_vmpressure(struct cgroup *cg)
+{
+	return &mem_cgroup_from_cont(cg)->vmpressure;
+}
+
+struct vmpressure *vmpressure_parent(struct vmpressure *vmpr)
+{
+	struct mem_cgroup *memcg;
+
+	memcg = container_of(vmpr, struct mem_cgroup, vmpressure);
+	memcg = parent_mem_cgroup(memcg);
+	if (!memcg)
+		return NULL;
+	return &memcg->vmpressure;
+}
+
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR_SWAP
 static void __init enable_swap_cgroup(void)
 {
@@ -4983,6 +5118,40 @@ static void __init enable_swap_cgroup(void)
 }
 #endif
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LAZY
+bool mem_cgroup_in_use __read_mostly;
+
+/*
+ * Pages are not charged to anything until the first cgroup below the
+ * root is created: the root cannot be limited, so until then there is
+ * nothing to account them for and no reason to pay for page_cgroup.
+ * Called under cgroup_mutex.
+ */
+static int mem_cgroup_start_lazy(void)
+{
+	int ret;
+
+	if (mem_cgroup_in_use || mem_cgroup_subsys.disabled)
+		return 0;
+	ret = page_cgroup_init_lazy();
+	if (ret)
+		return ret;
+	/*
+	 * The charge and LRU paths test mem_cgroup_in_use and then look
+	 * up page_cgroup without a barrier.  Make every cpu see the new
+	 * tables before any of them can see the flag.
+	 */
+	synchronize_sched();
+	mem_cgroup_in_use = true;
+	return 0;
+}
+#else
+static int mem_cgroup_start_lazy(void)
+{
+	return 0;
+}
+#endif
+
 static int mem_cgroup_soft_limit_tree_init(void)
 {
 	struct mem_cgroup_tree_per_node *rtpn;
@@ -5015,6 +5184,9 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	long error = -ENOMEM;
 	int node;
 
+	if (cont->parent && mem_cgroup_start_lazy())
+		return ERR_PTR(error);
+
 	mem = mem_cgroup_alloc();
 	if (!mem)
 		return ERR_PTR(error);
@@ -5060,9 +5232,12 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	mem->last_scanned_child = 0;
 	mem->last_scanned_node = MAX_NUMNODES;
 	INIT_LIST_HEAD(&mem->oom_notify);
+	vmpressure_init(&mem->vmpressure);
 
-	if (parent)
+	if (parent) {
 		mem->swappiness = get_swappiness(parent);
+		mem_cgroup_set_background(mem, parent->background);
+	}
 	atomic_set(&mem->refcnt, 1);
 	mem->move_charge_at_immigrate = 0;
 	mutex_init(&mem->thresholds_lock);
@@ -5085,6 +5260,7 @@ static void mem_cgroup_destroy(struct cgroup_subsys *ss,
 {
 	struct mem_cgroup *mem = mem_cgroup_from_cont(cont);
 
+	vmpressure_cleanup(&mem->vmpressure);
 	mem_cgroup_put(mem);
 }
 
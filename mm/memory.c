@@ -929,6 +929,54 @@ out_set_pte:
 	return 0;
 }
 
+/*
+ * copy_page_range() leaves file vmas without anon_vma to be faulted in
+ * again by the child.  The same holds for the page cache ptes of a file
+ * vma that does have anon pages, as long as ->fault is what put them
+ * there and no driver inserted pages or pfns of its own.
+ */
+static inline bool fork_can_refault(struct vm_area_struct *vma)
+{
+	return vma->vm_file && vma->vm_ops && vma->vm_ops->fault &&
+		!(vma->vm_flags & (VM_HUGETLB | VM_NONLINEAR | VM_PFNMAP |
+				   VM_MIXEDMAP | VM_INSERTPAGE));
+}
+
+static inline bool fork_skip_pte(struct vm_area_struct *vma,
+				 unsigned long addr, pte_t pte)
+{
+	struct page *page;
+
+	if (!pte_present(pte))
+		return false;
+	page = vm_normal_page(vma, addr, pte);
+	return page && !PageAnon(page);
+}
+
+/*
+ * Does any pte in this range have to be copied?  Ranges that only map
+ * page cache, like most of a relocated library or boot image, do not get
+ * a page table in the child at all.
+ */
+static bool fork_pte_range_needed(struct mm_struct *src_mm, pmd_t *src_pmd,
+				  struct vm_area_struct *vma,
+				  unsigned long addr, unsigned long end)
+{
+	pte_t *orig_pte, *pte;
+	spinlock_t *ptl;
+	bool needed = false;
+
+	orig_pte = pte = pte_offset_map_lock(src_mm, src_pmd, addr, &ptl);
+	do {
+		if (!pte_none(*pte) && !fork_skip_pte(vma, addr, *pte)) {
+			needed = true;
+			break;
+		}
+	} while (pte++, addr += PAGE_SIZE, addr != end);
+	pte_unmap_unlock(orig_pte, ptl);
+	return needed;
+}
+
 int copy_pte_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		   pmd_t *dst_pmd, pmd_t *src_pmd, struct vm_area_struct *vma,
 		   unsigned long addr, unsigned long end)
@@ -939,6 +987,7 @@ int copy_pte_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 	int progress = 0;
 	int rss[NR_MM_COUNTERS];
 	swp_entry_t entry = (swp_entry_t){0};
+	bool refault = fork_can_refault(vma);
 
 again:
 	init_rss_vec(rss);
@@ -964,7 +1013,8 @@ again:
 			    spin_needbreak(src_ptl) || spin_needbreak(dst_ptl))
 				break;
 		}
-		if (pte_none(*src_pte)) {
+		if (pte_none(*src_pte) ||
+		    (refault && fork_skip_pte(vma, addr, *src_pte))) {
 			progress++;
 			continue;
 		}
@@ -998,6 +1048,7 @@ static inline int copy_pmd_range(struct mm_struct *dst_mm, struct mm_struct *src
 {
 	pmd_t *src_pmd, *dst_pmd;
 	unsigned long next;
+	bool refault = fork_can_refault(vma);
 
 	dst_pmd = pmd_alloc(dst_mm, dst_pud, addr);
 	if (!dst_pmd)
@@ -1018,6 +1069,9 @@ static inline int copy_pmd_range(struct mm_struct *dst_mm, struct mm_struct *src
 		}
 		if (pmd_none_or_clear_bad(src_pmd))
 			continue;
+		if (refault &&
+		    !fork_pte_range_needed(src_mm, src_pmd, vma, addr, next))
+			continue;
 		if (copy_pte_range(dst_mm, src_mm, dst_pmd, src_pmd,
 						vma, addr, next))
 			return -ENOMEM;
@@ -1060,7 +1114,8 @@ int copy_page_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 	 * Don't copy ptes where a page fault will fill them correctly.
 	 * Fork becomes much lighter when there are big shared or private
 	 * readonly mappings. The tradeoff is that copy_page_range is more
-	 * efficient than faulting.
+	 * efficient than faulting.  File vmas with an anon_vma still have
+	 * their page cache ptes skipped, see fork_can_refault().
 	 */
 	if (!(vma->vm_flags & (VM_HUGETLB|VM_NONLINEAR|VM_PFNMAP|VM_INSERTPAGE))) {
 		if (!vma->anon_vma)
@@ -2941,6 +2996,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	int locked;
 	struct mem_cgroup *ptr;
 	int exclusive = 0;
+	int skip_swapcache = 0;
 	int ret = 0;
 
 	if (!pte_unmap_same(mm, pmd, page_table, orig_pte))
@@ -2959,11 +3015,15 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto out;
 	}
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
-	page = lookup_swap_cache(entry);
+	page = lookup_swap_cache(entry, vma);
 	if (!page) {
 		grab_swap_token(mm); /* Contend for token _before_ read-in */
-		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, address);
+		page = swapin_skip_swapcache(entry, vma, address);
+		if (page)
+			skip_swapcache = 1;
+		else
+			page = swap_vma_readahead(entry, GFP_HIGHUSER_MOVABLE,
+						  vma, address, pmd);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
@@ -2990,7 +3050,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto out_release;
 	}
 
-	locked = lock_page_or_retry(page, mm, flags);
+	/* A page read around the swap cache comes back locked */
+	locked = skip_swapcache || lock_page_or_retry(page, mm, flags);
 	delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
 	if (!locked) {
 		ret |= VM_FAULT_RETRY;
@@ -3003,7 +3064,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	 * test below, are not enough to exclude that.  Even if it is still
 	 * swapcache, we need to check that the page's swap has not changed.
 	 */
-	if (unlikely(!PageSwapCache(page) || page_private(page) != entry.val))
+	if (unlikely(!skip_swapcache && (!PageSwapCache(page) ||
+				page_private(page) != entry.val)))
 		goto out_page;
 
 	if (ksm_might_need_to_copy(page, vma, address)) {
@@ -3065,6 +3127,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	mem_cgroup_commit_charge_swapin(page, ptr);
 
 	swap_free(entry);
+	if (skip_swapcache)
+		swapcache_free(entry, NULL);
 	if ((PageSwapCache(page) && vm_swap_full(page_swap_info(page))) ||
 		(vma->vm_flags & VM_LOCKED) || PageMlocked(page))
 		try_to_free_swap(page);
@@ -3102,6 +3166,8 @@ out_page:
 	unlock_page(page);
 out_release:
 	page_cache_release(page);
+	if (skip_swapcache)
+		swapcache_free(entry, NULL);
 	if (swapcache) {
 		unlock_page(swapcache);
 		page_cache_release(swapcache);
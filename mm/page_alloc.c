@@ -1185,25 +1185,16 @@ void mark_free_pages(struct zone *zone)
 #endif /* CONFIG_PM */
 
 /*
- * Free a 0-order page
- * cold == 1 ? free a cold page : free a hot page
+ * Put a 0-order page, prepared for freeing and with its migratetype in
+ * page_private, on this cpu's pcp list.  Must be called with interrupts
+ * disabled.
  */
-void free_hot_cold_page(struct page *page, int cold)
+static void free_pcp_page(struct page *page, int cold)
 {
 	struct zone *zone = page_zone(page);
 	struct per_cpu_pages *pcp;
-	unsigned long flags;
-	int migratetype;
-	int wasMlocked = __TestClearPageMlocked(page);
+	int migratetype = page_private(page);
 
-	if (!free_pages_prepare(page, 0))
-		return;
-
-	migratetype = get_pageblock_migratetype(page);
-	set_page_private(page, migratetype);
-	local_irq_save(flags);
-	if (unlikely(wasMlocked))
-		free_page_mlock(page);
 	__count_vm_event(PGFREE);
 
 	/*
@@ -1216,7 +1207,7 @@ void free_hot_cold_page(struct page *page, int cold)
 	if (migratetype >= MIGRATE_PCPTYPES) {
 		if (unlikely(migratetype == MIGRATE_ISOLATE)) {
 			free_one_page(zone, page, 0, migratetype);
-			goto out;
+			return;
 		}
 		migratetype = MIGRATE_MOVABLE;
 	}
@@ -1231,11 +1222,65 @@ void free_hot_cold_page(struct page *page, int cold)
 		free_pcppages_bulk(zone, pcp->batch, pcp);
 		pcp->count -= pcp->batch;
 	}
+}
 
-out:
+/*
+ * Free a 0-order page
+ * cold == 1 ? free a cold page : free a hot page
+ */
+void free_hot_cold_page(struct page *page, int cold)
+{
+	unsigned long flags;
+	int wasMlocked = __TestClearPageMlocked(page);
+
+	if (!free_pages_prepare(page, 0))
+		return;
+
+	set_page_private(page, get_pageblock_migratetype(page));
+	local_irq_save(flags);
+	if (unlikely(wasMlocked))
+		free_page_mlock(page);
+	free_pcp_page(page, cold);
 	local_irq_restore(flags);
 }
 
+/*
+ * Free a list of 0-order pages whose reference counts have dropped to zero.
+ * Interrupts are disabled once for every SWAP_CLUSTER_MAX pages instead of
+ * once per page.  The list is left empty.
+ */
+void free_hot_cold_page_list(struct list_head *list, int cold)
+{
+	struct page *page, *next;
+	unsigned long flags;
+	LIST_HEAD(batch);
+	int nr;
+
+	while (!list_empty(list)) {
+		nr = 0;
+		list_for_each_entry_safe(page, next, list, lru) {
+			list_del(&page->lru);
+			if (unlikely(PageMlocked(page))) {
+				free_hot_cold_page(page, cold);
+				continue;
+			}
+			if (!free_pages_prepare(page, 0))
+				continue;
+			set_page_private(page, get_pageblock_migratetype(page));
+			list_add_tail(&page->lru, &batch);
+			if (++nr == SWAP_CLUSTER_MAX)
+				break;
+		}
+
+		local_irq_save(flags);
+		list_for_each_entry_safe(page, next, &batch, lru) {
+			list_del(&page->lru);
+			free_pcp_page(page, cold);
+		}
+		local_irq_restore(flags);
+	}
+}
+
 /*
  * split_page takes a non-compound higher-order page, and splits it into
  * n (1<<order) sub-pages: page[0..n]
@@ -2410,6 +2455,115 @@ out:
 }
 EXPORT_SYMBOL(__alloc_pages_nodemask);
 
+/* Most pages alloc_pages_bulk() takes with interrupts disabled */
+#define ALLOC_BULK_CHUNK	256
+
+/*
+ * alloc_pages_bulk - allocate a number of 0-order pages onto a list
+ * @gfp_mask: allocation flags, as for alloc_page()
+ * @nr_pages: number of pages wanted
+ * @list: list the pages are added to, through page->lru
+ *
+ * While the preferred zone is above its low watermark, pages are taken
+ * from this cpu's pcp list and then straight from the buddy lists, up to
+ * ALLOC_BULK_CHUNK of them under one hold of zone->lock, instead of one
+ * pcp->batch at a time.  The rest are allocated one by one, with all the
+ * fallbacks and reclaim alloc_page() may go through.
+ *
+ * Returns the number of pages added to @list, which may be less than
+ * @nr_pages if the allocation failed.
+ */
+unsigned long alloc_pages_bulk(gfp_t gfp_mask, unsigned long nr_pages,
+			       struct list_head *list)
+{
+	enum zone_type high_zoneidx = gfp_zone(gfp_mask);
+	int migratetype = allocflags_to_migratetype(gfp_mask);
+	int cold = !!(gfp_mask & __GFP_COLD);
+	struct zonelist *zonelist;
+	struct zone *zone;
+	struct per_cpu_pages *pcp;
+	struct list_head *pcp_list;
+	struct page *page, *next;
+	unsigned long flags;
+	unsigned long nr_alloced = 0;
+	unsigned long chunk, got, i;
+	LIST_HEAD(pages);
+
+	gfp_mask &= gfp_allowed_mask;
+
+	if (nr_pages < 2 || kmemcheck_enabled)
+		goto slow;
+#ifdef CONFIG_NUMA
+	/* The memory policy is for alloc_pages_current() to apply */
+	if (current->mempolicy && !in_interrupt())
+		goto slow;
+#endif
+
+	might_sleep_if(gfp_mask & __GFP_WAIT);
+
+	zonelist = node_zonelist(numa_node_id(), gfp_mask);
+	first_zones_zonelist(zonelist, high_zoneidx,
+			     &cpuset_current_mems_allowed, &zone);
+	if (!zone || !cpuset_zone_allowed_softwall(zone,
+						   gfp_mask | __GFP_HARDWALL))
+		goto slow;
+
+	while (nr_alloced < nr_pages) {
+		chunk = min(nr_pages - nr_alloced,
+			    (unsigned long)ALLOC_BULK_CHUNK);
+		/* Leave it to the slow path to wake kswapd or reclaim */
+		if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone) + chunk,
+				       zone_idx(zone), 0))
+			break;
+
+		local_irq_save(flags);
+		pcp = &this_cpu_ptr(zone->pageset)->pcp;
+		pcp_list = &pcp->lists[migratetype];
+		for (got = 0; got < chunk && !list_empty(pcp_list); got++) {
+			if (cold)
+				page = list_entry(pcp_list->prev,
+						  struct page, lru);
+			else
+				page = list_entry(pcp_list->next,
+						  struct page, lru);
+			list_move_tail(&page->lru, &pages);
+			pcp->count--;
+		}
+		if (got < chunk)
+			got += rmqueue_bulk(zone, 0, chunk - got, &pages,
+					    migratetype, cold);
+		__count_zone_vm_events(PGALLOC, zone, got);
+		for (i = 0; i < got; i++)
+			zone_statistics(zone, zone, gfp_mask);
+		local_irq_restore(flags);
+
+		list_for_each_entry_safe(page, next, &pages, lru) {
+			list_del(&page->lru);
+			VM_BUG_ON(bad_range(zone, page));
+			/* A bad page is left alone, as buffered_rmqueue() does */
+			if (prep_new_page(page, 0, gfp_mask))
+				continue;
+			trace_mm_page_alloc(page, 0, gfp_mask, migratetype);
+			list_add_tail(&page->lru, list);
+			nr_alloced++;
+		}
+
+		if (got < chunk)
+			break;
+	}
+
+slow:
+	while (nr_alloced < nr_pages) {
+		page = alloc_page(gfp_mask);
+		if (!page)
+			break;
+		list_add_tail(&page->lru, list);
+		nr_alloced++;
+	}
+	return nr_alloced;
+}
+EXPORT_SYMBOL(alloc_pages_bulk);
+
 /*
  * Common helper functions.
  */
@@ -2439,11 +2593,13 @@ EXPORT_SYMBOL(get_zeroed_page);
 void __pagevec_free(struct pagevec *pvec)
 {
 	int i = pagevec_count(pvec);
+	LIST_HEAD(pages);
 
 	while (--i >= 0) {
 		trace_mm_pagevec_free(pvec->pages[i], pvec->cold);
-		free_hot_cold_page(pvec->pages[i], pvec->cold);
+		list_add(&pvec->pages[i]->lru, &pages);
 	}
+	free_hot_cold_page_list(&pages, pvec->cold);
 }
 
 void __free_pages(struct page *page, unsigned int order)
@@ -2458,6 +2614,24 @@ void __free_pages(struct page *page, unsigned int order)
 
 EXPORT_SYMBOL(__free_pages);
 
+/*
+ * free_pages_bulk - drop a reference to each 0-order page on @list, and
+ * free together those for which it was the last.  The list is left empty.
+ */
+void free_pages_bulk(struct list_head *list)
+{
+	struct page *page, *next;
+	LIST_HEAD(pages);
+
+	list_for_each_entry_safe(page, next, list, lru) {
+		list_del(&page->lru);
+		if (put_page_testzero(page))
+			list_add_tail(&page->lru, &pages);
+	}
+	free_hot_cold_page_list(&pages, 0);
+}
+EXPORT_SYMBOL(free_pages_bulk);
+
 void free_pages(unsigned long addr, unsigned int order)
 {
 	if (addr != 0) {
@@ -4412,6 +4586,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	pgdat->kswapd_max_order = 0;
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat_page_cgroup_init(pgdat);
 	
 	for (j = 0; j < MAX_NR_ZONES; j++) {
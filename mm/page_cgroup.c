@@ -11,7 +11,17 @@
 #include <linux/swapops.h>
 #include <linux/kmemleak.h>
 
-static void __meminit init_page_cgroup(struct page_cgroup *pc, unsigned long id)
+/*
+ * In lazy mode the tables are allocated when the first memory cgroup is
+ * created, long after the init sections are gone.
+ */
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LAZY
+#define __pcg_init
+#else
+#define __pcg_init	__meminit
+#endif
+
+static void __pcg_init init_page_cgroup(struct page_cgroup *pc, unsigned long id)
 {
 	pc->flags = 0;
 	set_page_cgroup_array_id(pc, id);
@@ -105,6 +115,40 @@ fail:
 	panic("Out of memory");
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LAZY
+/*
+ * Called under cgroup_mutex when the first memory cgroup below the root
+ * is created.  A node's table is far too big for the page allocator at
+ * that point, so it comes from vmalloc.  Tables allocated before a
+ * failure are kept for the next attempt.
+ */
+int page_cgroup_init_lazy(void)
+{
+	struct page_cgroup *base;
+	unsigned long table_size, nr_pages, index;
+	int nid;
+
+	for_each_online_node(nid) {
+		if (NODE_DATA(nid)->node_page_cgroup)
+			continue;
+		nr_pages = NODE_DATA(nid)->node_spanned_pages;
+		if (!nr_pages)
+			continue;
+
+		table_size = sizeof(struct page_cgroup) * nr_pages;
+		base = vmalloc_node(table_size, nid);
+		if (!base)
+			return -ENOMEM;
+		for (index = 0; index < nr_pages; index++)
+			init_page_cgroup(base + index, nid);
+		NODE_DATA(nid)->node_page_cgroup = base;
+		total_usage += table_size;
+	}
+	printk(KERN_INFO "allocated %ld bytes of page_cgroup\n", total_usage);
+	return 0;
+}
+#endif
+
 #else /* CONFIG_FLAT_NODE_MEM_MAP */
 
 struct page_cgroup *lookup_page_cgroup(struct page *page)
@@ -130,7 +174,7 @@ struct page *lookup_cgroup_page(struct page_cgroup *pc)
 	return page;
 }
 
-static void *__meminit alloc_page_cgroup(size_t size, int nid)
+static void *__pcg_init alloc_page_cgroup(size_t size, int nid)
 {
 	void *addr = NULL;
 
@@ -162,7 +206,7 @@ static void free_page_cgroup(void *addr)
 }
 #endif
 
-static int __meminit init_section_page_cgroup(unsigned long pfn, int nid)
+static int __pcg_init init_section_page_cgroup(unsigned long pfn, int nid)
 {
 	struct page_cgroup *base, *pc;
 	struct mem_section *section;
@@ -294,41 +338,47 @@ static int __meminit page_cgroup_callback(struct notifier_block *self,
 
 #endif
 
+static int __pcg_init init_node_page_cgroup(int nid)
+{
+	unsigned long pfn, start_pfn, end_pfn;
+
+	start_pfn = node_start_pfn(nid);
+	end_pfn = node_end_pfn(nid);
+	/*
+	 * start_pfn and end_pfn may not be aligned to SECTION and the
+	 * page->flags of out of node pages are not initialized.  So we
+	 * scan [start_pfn, the biggest section's pfn < end_pfn) here.
+	 */
+	for (pfn = start_pfn;
+	     pfn < end_pfn;
+	     pfn = ALIGN(pfn + 1, PAGES_PER_SECTION)) {
+
+		if (!pfn_valid(pfn))
+			continue;
+		/*
+		 * Nodes's pfns can be overlapping.
+		 * We know some arch can have a nodes layout such as
+		 * -------------pfn-------------->
+		 * N0 | N1 | N2 | N0 | N1 | N2|....
+		 */
+		if (pfn_to_nid(pfn) != nid)
+			continue;
+		if (init_section_page_cgroup(pfn, nid))
+			return -ENOMEM;
+	}
+	return 0;
+}
+
 void __init page_cgroup_init(void)
 {
-	unsigned long pfn;
 	int nid;
 
 	if (mem_cgroup_disabled())
 		return;
 
 	for_each_node_state(nid, N_HIGH_MEMORY) {
-		unsigned long start_pfn, end_pfn;
-
-		start_pfn = node_start_pfn(nid);
-		end_pfn = node_end_pfn(nid);
-		/*
-		 * start_pfn and end_pfn may not be aligned to SECTION and the
-		 * page->flags of out of node pages are not initialized.  So we
-		 * scan [start_pfn, the biggest section's pfn < end_pfn) here.
-		 */
-		for (pfn = start_pfn;
-		     pfn < end_pfn;
-                     pfn = ALIGN(pfn + 1, PAGES_PER_SECTION)) {
-
-			if (!pfn_valid(pfn))
-				continue;
-			/*
-			 * Nodes's pfns can be overlapping.
-			 * We know some arch can have a nodes layout such as
-			 * -------------pfn-------------->
-			 * N0 | N1 | N2 | N0 | N1 | N2|....
-			 */
-			if (pfn_to_nid(pfn) != nid)
-				continue;
-			if (init_section_page_cgroup(pfn, nid))
-				goto oom;
-		}
+		if (init_node_page_cgroup(nid))
+			goto oom;
 	}
 	hotplug_memory_notifier(page_cgroup_callback, 0);
 	printk(KERN_INFO "allocated %ld bytes of page_cgroup\n", total_usage);
@@ -340,6 +390,32 @@ oom:
 	panic("Out of memory");
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LAZY
+/*
+ * Called under cgroup_mutex when the first memory cgroup below the root
+ * is created.  Sections set up before a failure are kept for the next
+ * attempt.
+ */
+int page_cgroup_init_lazy(void)
+{
+	int nid, ret = 0;
+
+	lock_memory_hotplug();
+	for_each_node_state(nid, N_HIGH_MEMORY) {
+		ret = init_node_page_cgroup(nid);
+		if (ret)
+			break;
+	}
+	if (!ret) {
+		hotplug_memory_notifier(page_cgroup_callback, 0);
+		printk(KERN_INFO "allocated %ld bytes of page_cgroup\n",
+		       total_usage);
+	}
+	unlock_memory_hotplug();
+	return ret;
+}
+#endif
+
 void __meminit pgdat_page_cgroup_init(struct pglist_data *pgdat)
 {
 	return;
@@ -17,6 +17,11 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/slab.h>
+#include <linux/vmstat.h>
+
+#include "internal.h"
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -139,6 +144,213 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_READAHEAD_HISTORY
+/*
+ * Readahead history.
+ *
+ * Applications tend to read the same files in the same way every time they
+ * start.  For each recently read file we remember which ranges were read
+ * from disk during the first RA_HISTORY_RECORD seconds after the history
+ * was created.  When the file has then been idle for RA_HISTORY_IDLE
+ * seconds, the next readahead replays all recorded ranges at once under a
+ * single plug, instead of letting the application fault them in one
+ * window at a time.
+ *
+ * Histories are keyed by superblock, inode number and generation and are
+ * thrown away when the size or mtime of the file no longer match.
+ */
+#define RA_HISTORY_HASH_BITS	8
+#define RA_HISTORY_MAX_FILES	256
+#define RA_HISTORY_RANGES	32
+#define RA_HISTORY_RECORD	10	/* seconds */
+#define RA_HISTORY_IDLE		30	/* seconds */
+
+struct ra_history_range {
+	pgoff_t start;
+	unsigned long nr;
+};
+
+struct ra_history {
+	struct hlist_node hash;
+	struct list_head lru;
+	struct super_block *sb;
+	unsigned long ino;
+	u32 generation;
+	loff_t size;
+	struct timespec mtime;
+	unsigned long record_until;	/* jiffies */
+	unsigned long last_access;	/* jiffies */
+	unsigned int nr_ranges;
+	struct ra_history_range ranges[RA_HISTORY_RANGES];
+};
+
+int sysctl_readahead_history __read_mostly = 1;
+
+static DEFINE_SPINLOCK(ra_history_lock);
+static struct hlist_head ra_history_hash[1 << RA_HISTORY_HASH_BITS];
+static LIST_HEAD(ra_history_lru);
+static unsigned int ra_history_count;
+
+static struct hlist_head *ra_history_bucket(struct inode *inode)
+{
+	unsigned long key = inode->i_ino ^ (unsigned long)inode->i_sb;
+
+	return &ra_history_hash[hash_long(key, RA_HISTORY_HASH_BITS)];
+}
+
+static struct ra_history *ra_history_lookup(struct inode *inode)
+{
+	struct ra_history *h;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(h, node, ra_history_bucket(inode), hash) {
+		if (h->sb == inode->i_sb && h->ino == inode->i_ino &&
+		    h->generation == inode->i_generation)
+			return h;
+	}
+	return NULL;
+}
+
+static void ra_history_reset(struct ra_history *h, struct inode *inode)
+{
+	h->size = i_size_read(inode);
+	h->mtime = inode->i_mtime;
+	h->record_until = jiffies + RA_HISTORY_RECORD * HZ;
+	h->last_access = jiffies;
+	h->nr_ranges = 0;
+}
+
+/* Find or set up the history of an inode. Called with ra_history_lock held */
+static struct ra_history *ra_history_get(struct inode *inode)
+{
+	struct ra_history *h = ra_history_lookup(inode);
+
+	if (h) {
+		if (h->size != i_size_read(inode) ||
+		    !timespec_equal(&h->mtime, &inode->i_mtime))
+			ra_history_reset(h, inode);
+		list_move(&h->lru, &ra_history_lru);
+		return h;
+	}
+
+	if (ra_history_count >= RA_HISTORY_MAX_FILES) {
+		h = list_entry(ra_history_lru.prev, struct ra_history, lru);
+		hlist_del(&h->hash);
+		list_del(&h->lru);
+	} else {
+		h = kmalloc(sizeof(*h), GFP_ATOMIC | __GFP_NOWARN);
+		if (!h)
+			return NULL;
+		ra_history_count++;
+	}
+
+	h->sb = inode->i_sb;
+	h->ino = inode->i_ino;
+	h->generation = inode->i_generation;
+	ra_history_reset(h, inode);
+	hlist_add_head(&h->hash, ra_history_bucket(inode));
+	list_add(&h->lru, &ra_history_lru);
+	return h;
+}
+
+static void ra_history_add_range(struct ra_history *h, pgoff_t start,
+				 unsigned long nr)
+{
+	struct ra_history_range *r;
+	unsigned int i;
+
+	for (i = 0; i < h->nr_ranges; i++) {
+		r = &h->ranges[i];
+		if (start + nr < r->start || start > r->start + r->nr)
+			continue;
+		/* overlapping or adjacent: merge */
+		if (start < r->start) {
+			r->nr += r->start - start;
+			r->start = start;
+		}
+		if (start + nr > r->start + r->nr)
+			r->nr = start + nr - r->start;
+		return;
+	}
+
+	if (h->nr_ranges < RA_HISTORY_RANGES) {
+		r = &h->ranges[h->nr_ranges++];
+		r->start = start;
+		r->nr = nr;
+	}
+}
+
+static int
+__do_page_cache_readahead(struct address_space *mapping, struct file *filp,
+			pgoff_t offset, unsigned long nr_to_read,
+			unsigned long lookahead_size);
+
+/*
+ * Note that readahead just went to disk for a range of a file: record it
+ * while the history is young, and replay the whole history if this is the
+ * first read after the file has been idle.
+ */
+static void ra_history_note(struct address_space *mapping, struct file *filp,
+			    pgoff_t offset, unsigned long nr, int actual)
+{
+	struct inode *inode = mapping->host;
+	struct ra_history_range *replay = NULL;
+	struct ra_history *h;
+	struct blk_plug plug;
+	unsigned int nr_replay = 0;
+	unsigned long pages = 0;
+	unsigned int i;
+
+	if (!sysctl_readahead_history || actual <= 0 ||
+	    !S_ISREG(inode->i_mode))
+		return;
+
+	spin_lock(&ra_history_lock);
+	h = ra_history_get(inode);
+	if (!h)
+		goto unlock;
+
+	if (time_before(jiffies, h->record_until)) {
+		ra_history_add_range(h, offset, nr);
+	} else if (time_after(jiffies, h->last_access +
+			      RA_HISTORY_IDLE * HZ) && h->nr_ranges) {
+		replay = kmemdup(h->ranges,
+				 h->nr_ranges * sizeof(*replay),
+				 GFP_ATOMIC | __GFP_NOWARN);
+		if (replay)
+			nr_replay = h->nr_ranges;
+	} else {
+		count_vm_events(RA_HISTORY_MISS, actual);
+	}
+	h->last_access = jiffies;
+unlock:
+	spin_unlock(&ra_history_lock);
+
+	if (!replay)
+		return;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr_replay; i++) {
+		int ret = __do_page_cache_readahead(mapping, filp,
+				replay[i].start,
+				max_sane_readahead(replay[i].nr), 0);
+		if (ret > 0)
+			pages += ret;
+	}
+	blk_finish_plug(&plug);
+	kfree(replay);
+
+	count_vm_event(RA_HISTORY_REPLAY);
+	count_vm_events(RA_HISTORY_PAGES, pages);
+}
+#else
+static inline void ra_history_note(struct address_space *mapping,
+				   struct file *filp, pgoff_t offset,
+				   unsigned long nr, int actual)
+{
+}
+#endif /* CONFIG_READAHEAD_HISTORY */
+
 /*
  * __do_page_cache_readahead() actually reads a chunk of disk.  It allocates all
  * the pages first, then submits them all for I/O. This avoids the very bad
@@ -228,6 +440,8 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 			ret = err;
 			break;
 		}
+		ra_history_note(mapping, filp, offset, this_chunk, err);
+		boot_prefetch_note(filp, offset, this_chunk, err);
 		ret += err;
 		offset += this_chunk;
 		nr_to_read -= this_chunk;
@@ -255,6 +469,8 @@ unsigned long ra_submit(struct file_ra_state *ra,
 
 	actual = __do_page_cache_readahead(mapping, filp,
 					ra->start, ra->size, ra->async_size);
+	ra_history_note(mapping, filp, ra->start, ra->size, actual);
+	boot_prefetch_note(filp, ra->start, ra->size, actual);
 
 	return actual;
 }
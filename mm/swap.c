@@ -656,8 +656,8 @@ void __pagevec_release(struct pagevec *pvec)
 EXPORT_SYMBOL(__pagevec_release);
 
 /* used by __split_huge_page_refcount() */
-void lru_add_page_tail(struct zone* zone,
-		       struct page *page, struct page *page_tail)
+void lru_add_page_tail(struct zone* zone, struct page *page,
+		       struct page *page_tail, struct list_head *list)
 {
 	int active;
 	enum lru_list lru;
@@ -669,6 +669,13 @@ void lru_add_page_tail(struct zone* zone,
 	VM_BUG_ON(PageLRU(page_tail));
 	VM_BUG_ON(NR_CPUS != 1 && !spin_is_locked(&zone->lru_lock));
 
+	if (!PageLRU(page) && list) {
+		/* page reclaim is splitting the head it isolated */
+		get_page(page_tail);
+		list_add_tail(&page_tail->lru, list);
+		return;
+	}
+
 	SetPageLRU(page_tail);
 
 	if (page_evictable(page_tail, NULL)) {
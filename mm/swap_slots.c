@@ -0,0 +1,177 @@
+/*
+ *  linux/mm/swap_slots.c
+ *
+ *  Per-cpu caches of swap slots.
+ *
+ *  Every swap slot allocated or freed used to take swap_lock, which
+ *  serializes all the CPUs reclaiming anonymous memory.  Instead, each
+ *  CPU takes SWAP_SLOTS_CACHE_SIZE free slots at a time from
+ *  get_swap_pages() and hands them out one by one, and collects the
+ *  slots freed on it until it can give back a full batch to
+ *  swapcache_free_entries().
+ *
+ *  Slots sitting in a cache are marked SWAP_HAS_CACHE in swap_map with
+ *  no page in the swap cache and no references, so the rest of the swap
+ *  code sees them as allocated.  swapoff empties the caches and bypasses
+ *  them while it runs, and the caches are bypassed for allocation when
+ *  swap is nearly full, so that no CPU sits on slots another one needs.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/cpu.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/notifier.h>
+#include <linux/init.h>
+
+#define SWAP_SLOTS_CACHE_SIZE	64
+
+/* Below this many free slots per CPU, allocate without the caches */
+#define SWAP_SLOTS_LOW		(2 * SWAP_SLOTS_CACHE_SIZE)
+
+struct swap_slots_cache {
+	struct mutex	alloc_lock;	/* protects slots, cur and nr */
+	swp_entry_t	slots[SWAP_SLOTS_CACHE_SIZE];
+	int		cur;
+	int		nr;
+	spinlock_t	free_lock;	/* protects slots_ret and n_ret */
+	swp_entry_t	slots_ret[SWAP_SLOTS_CACHE_SIZE];
+	int		n_ret;
+};
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swp_slots);
+static bool swap_slots_cache_enabled __read_mostly;
+static int swap_slots_cache_disabled;
+static DEFINE_MUTEX(swap_slots_cache_mutex);
+
+static void drain_slots_cache_cpu(unsigned int cpu)
+{
+	struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+	mutex_lock(&cache->alloc_lock);
+	if (cache->nr) {
+		swapcache_free_entries(cache->slots + cache->cur, cache->nr);
+		cache->cur = 0;
+		cache->nr = 0;
+	}
+	mutex_unlock(&cache->alloc_lock);
+
+	spin_lock(&cache->free_lock);
+	if (cache->n_ret) {
+		swapcache_free_entries(cache->slots_ret, cache->n_ret);
+		cache->n_ret = 0;
+	}
+	spin_unlock(&cache->free_lock);
+}
+
+/*
+ * Empty all caches and keep them out of the way until the matching
+ * reenable_swap_slots_cache().
+ */
+void disable_swap_slots_cache(void)
+{
+	int cpu;
+
+	mutex_lock(&swap_slots_cache_mutex);
+	swap_slots_cache_disabled++;
+	swap_slots_cache_enabled = false;
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		drain_slots_cache_cpu(cpu);
+	put_online_cpus();
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+void reenable_swap_slots_cache(void)
+{
+	mutex_lock(&swap_slots_cache_mutex);
+	if (!--swap_slots_cache_disabled)
+		swap_slots_cache_enabled = true;
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+/*
+ * Give back a slot that swap_entry_free() left reserved.  Called without
+ * swap_lock held, possibly under a page table lock.
+ */
+void free_swap_slot(swp_entry_t entry)
+{
+	struct swap_slots_cache *cache;
+
+	cache = &get_cpu_var(swp_slots);
+	spin_lock(&cache->free_lock);
+	if (!swap_slots_cache_enabled) {
+		spin_unlock(&cache->free_lock);
+		put_cpu_var(swp_slots);
+		swapcache_free_entries(&entry, 1);
+		return;
+	}
+	if (cache->n_ret >= SWAP_SLOTS_CACHE_SIZE) {
+		swapcache_free_entries(cache->slots_ret, cache->n_ret);
+		cache->n_ret = 0;
+	}
+	cache->slots_ret[cache->n_ret++] = entry;
+	spin_unlock(&cache->free_lock);
+	put_cpu_var(swp_slots);
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry;
+
+	entry.val = 0;
+	if (!swap_slots_cache_enabled ||
+	    nr_swap_pages < SWAP_SLOTS_LOW * num_online_cpus())
+		goto direct;
+
+	/* The mutex, not the cpu, protects the cache: we may sleep */
+	cache = &per_cpu(swp_slots, raw_smp_processor_id());
+	mutex_lock(&cache->alloc_lock);
+	if (!swap_slots_cache_enabled) {
+		mutex_unlock(&cache->alloc_lock);
+		goto direct;
+	}
+	if (!cache->nr) {
+		cache->cur = 0;
+		cache->nr = get_swap_pages(SWAP_SLOTS_CACHE_SIZE, cache->slots);
+	}
+	if (cache->nr) {
+		entry = cache->slots[cache->cur++];
+		cache->nr--;
+	}
+	mutex_unlock(&cache->alloc_lock);
+	return entry;
+
+direct:
+	get_swap_pages(1, &entry);
+	return entry;
+}
+
+static int swap_slots_cpu_notify(struct notifier_block *self,
+				 unsigned long action, void *hcpu)
+{
+	int cpu = (unsigned long)hcpu;
+
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN)
+		drain_slots_cache_cpu(cpu);
+	return NOTIFY_OK;
+}
+
+static int __init swap_slots_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+		mutex_init(&cache->alloc_lock);
+		spin_lock_init(&cache->free_lock);
+	}
+	hotcpu_notifier(swap_slots_cpu_notify, 0);
+	swap_slots_cache_enabled = true;
+	return 0;
+}
+subsys_initcall(swap_slots_init);
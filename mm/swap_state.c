@@ -19,6 +19,7 @@
 #include <linux/pagevec.h>
 #include <linux/migrate.h>
 #include <linux/page_cgroup.h>
+#include <linux/blkdev.h>
 
 #include <asm/pgtable.h>
 
@@ -140,11 +141,12 @@ void __delete_from_swap_cache(struct page *page)
 /**
  * add_to_swap - allocate swap space for a page
  * @page: page we want to move to swap
+ * @list: reclaim's page list, for the tail pages of a split hugepage
  *
  * Allocate swap space for the page and add the page to the
  * swap cache.  Caller needs to hold the page lock. 
  */
-int add_to_swap(struct page *page)
+int add_to_swap(struct page *page, struct list_head *list)
 {
 	swp_entry_t entry;
 	int err;
@@ -157,7 +159,7 @@ int add_to_swap(struct page *page)
 		return 0;
 
 	if (unlikely(PageTransHuge(page)))
-		if (unlikely(split_huge_page(page))) {
+		if (unlikely(split_huge_page_to_list(page, list))) {
 			swapcache_free(entry, NULL);
 			return 0;
 		}
@@ -256,20 +258,63 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	}
 }
 
+/*
+ * The VMA based readahead keeps its state in vma->swap_readahead_info:
+ * the page aligned address of the last swapin fault, with the window
+ * read around it and the readahead pages used since packed into the low
+ * bits.  It is only ever changed with atomic_long_cmpxchg(), since the
+ * faults of several threads can update it under a shared mmap_sem.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((unsigned long)(win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) | \
+	 ((unsigned long)(hits) & SWAP_RA_HITS_MASK))
+
+static void swap_ra_hit(struct vm_area_struct *vma)
+{
+	unsigned long old, val;
+
+	do {
+		old = atomic_long_read(&vma->swap_readahead_info);
+		if (SWAP_RA_HITS(old) >= SWAP_RA_HITS_MAX)
+			return;
+		val = old + 1;
+	} while (atomic_long_cmpxchg(&vma->swap_readahead_info,
+				     old, val) != old);
+}
+
 /*
  * Lookup a swap entry in the swap cache. A found page will be returned
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
- * lock before returning.
+ * lock before returning.  A readahead page found for a fault in @vma
+ * counts towards the readahead window of @vma, which may be NULL.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page * lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		/* PG_readahead is PG_reclaim: mind pages under writeback */
+		if (!PageWriteback(page) && PageReadahead(page)) {
+			ClearPageReadahead(page);
+			if (vma)
+				swap_ra_hit(vma);
+			count_vm_event(SWAP_RA_HIT);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -277,16 +322,21 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 /* 
  * Locate a page of swap in physical memory, reserving swap cache space
- * and reading the disk if it is not already cached.
+ * and reading the disk if it is not already cached.  *new_page_allocated
+ * tells whether the page returned is one read in by this call.  With
+ * @readahead set, give up rather than wait on a slot that is reserved
+ * but not in use.
  * A failure return means that either the page allocation failed or that
  * the swap entry is no longer in use.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool readahead, bool *new_page_allocated)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_allocated = false;
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -319,6 +369,14 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		err = swapcache_prepare(entry);
 		if (err == -EEXIST) {
 			radix_tree_preload_end();
+			/*
+			 * A slot with no references is only reserved: it is
+			 * in a swap slots cache or being allocated, and there
+			 * is nothing to read ahead.  Everybody else waits for
+			 * the page, as below.
+			 */
+			if (readahead && !__swp_swapcount(entry))
+				break;
 			/*
 			 * We might race against get_swap_page() and stumble
 			 * across a SWAP_HAS_CACHE swap_map entry whose page
@@ -353,6 +411,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*new_page_allocated = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -370,6 +429,21 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+/*
+ * Locate a page of swap in physical memory, reserving swap cache space
+ * and reading the disk if it is not already cached.
+ * A failure return means that either the page allocation failed or that
+ * the swap entry is no longer in use.
+ */
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool page_was_allocated;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr, false,
+				       &page_was_allocated);
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -396,6 +470,7 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	struct page *page;
 	unsigned long offset;
 	unsigned long end_offset;
+	bool page_was_allocated;
 
 	/*
 	 * Get starting offset for readaround, and number of pages to read.
@@ -407,8 +482,8 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
+		page = __read_swap_cache_async(swp_entry(swp_type(entry), offset),
+				gfp_mask, vma, addr, true, &page_was_allocated);
 		if (!page)
 			break;
 		page_cache_release(page);
@@ -416,3 +491,182 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+int sysctl_swap_vma_readahead __read_mostly = 1;
+int sysctl_swapin_skip_swapcache __read_mostly = 1;
+
+/* Most page table entries looked at by one VMA based readahead */
+#define SWAP_RA_VMA_MAX		32
+
+/*
+ * Size the next readahead window of @vma from how many of the pages it
+ * read ahead since the last fault were used: grow it while they are, but
+ * shrink it at most by half per fault.  With no hits to go by, read ahead
+ * a little only if this fault is next to the previous one, whose address
+ * is returned in *prev.
+ */
+static unsigned int swap_ra_window(struct vm_area_struct *vma,
+				   unsigned long addr, unsigned long *prev)
+{
+	unsigned int max = min(1 << page_cluster, SWAP_RA_VMA_MAX);
+	unsigned long old, val;
+	unsigned int pages;
+
+	do {
+		old = atomic_long_read(&vma->swap_readahead_info);
+		*prev = SWAP_RA_ADDR(old);
+		pages = SWAP_RA_HITS(old) + 2;
+		if (max <= 1) {
+			pages = 1;
+		} else if (pages == 2) {
+			if (addr != *prev + PAGE_SIZE &&
+			    addr != *prev - PAGE_SIZE)
+				pages = 1;
+		} else {
+			unsigned int roundup = 4;
+
+			while (roundup < pages)
+				roundup <<= 1;
+			pages = roundup;
+		}
+		if (pages > max)
+			pages = max;
+		if (pages < SWAP_RA_WIN(old) / 2)
+			pages = SWAP_RA_WIN(old) / 2;
+		val = SWAP_RA_VAL(addr, pages, 0);
+	} while (atomic_long_cmpxchg(&vma->swap_readahead_info,
+				     old, val) != old);
+	return pages;
+}
+
+/**
+ * swap_vma_readahead - swap in pages near the fault address
+ * @entry: swap entry of the faulting page
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma the faulting address belongs to
+ * @addr: faulting address
+ * @pmd: pmd mapping @addr
+ *
+ * On devices where seeks are cheap, the pages a process will fault on
+ * next are better predicted by its virtual addresses than by where the
+ * pages happened to land in the swap area.  So read the swap entries in
+ * the page table around @addr, within @vma and the page table page, in
+ * a window sized by swap_ra_window().  Rotating devices, and swap
+ * entries not found in a process page table, keep the swap offset based
+ * swapin_readahead().
+ *
+ * Caller must hold down_read on the vma->vm_mm if vma is not NULL.
+ */
+struct page *swap_vma_readahead(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	struct swap_info_struct *si = swp_swap_info(entry);
+	pte_t ptes[SWAP_RA_VMA_MAX];
+	unsigned long prev, start, end, a;
+	struct blk_plug plug;
+	unsigned int win, i;
+	pte_t *pte;
+
+	if (!sysctl_swap_vma_readahead || !(si->flags & SWP_SOLIDSTATE))
+		return swapin_readahead(entry, gfp_mask, vma, addr);
+
+	addr &= PAGE_MASK;
+	win = swap_ra_window(vma, addr, &prev);
+	if (win <= 1)
+		goto skip;
+
+	/* Follow the direction of sequential faults, else read around */
+	if (addr == prev + PAGE_SIZE) {
+		start = addr;
+	} else if (addr == prev - PAGE_SIZE) {
+		start = addr - (win - 1) * PAGE_SIZE;
+	} else {
+		start = addr & ~((unsigned long)win * PAGE_SIZE - 1);
+	}
+	end = start + win * PAGE_SIZE;
+	start = max3(start, vma->vm_start, addr & PMD_MASK);
+	end = min3(end, vma->vm_end, (addr & PMD_MASK) + PMD_SIZE);
+	if (start >= end || start > addr || end <= addr)
+		goto skip;
+
+	/* The entries are only hints: read_swap_cache_async() checks them */
+	pte = pte_offset_map(pmd, start);
+	for (a = start, i = 0; a < end; a += PAGE_SIZE, i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	blk_start_plug(&plug);
+	for (a = start, i = 0; a < end; a += PAGE_SIZE, i++) {
+		swp_entry_t ra_entry;
+		struct page *page;
+		bool page_was_allocated;
+
+		if (a == addr || !is_swap_pte(ptes[i]))
+			continue;
+		ra_entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(ra_entry)))
+			continue;
+		page = __read_swap_cache_async(ra_entry, gfp_mask, vma, a,
+					       true, &page_was_allocated);
+		if (!page)
+			continue;
+		/* Only pages read in here tell whether readahead paid off */
+		if (page_was_allocated) {
+			SetPageReadahead(page);
+			count_vm_event(SWAP_RA);
+		}
+		page_cache_release(page);
+	}
+	blk_finish_plug(&plug);
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
+	return read_swap_cache_async(entry, gfp_mask, vma, addr);
+}
+
+/**
+ * swapin_skip_swapcache - swap in a page without the swap cache
+ * @entry: swap entry of the faulting page
+ * @vma: user vma the faulting address belongs to
+ * @addr: faulting address
+ *
+ * A page read back from a device like zram that only its faulting process
+ * maps gains nothing from the swap cache: nobody else will look for it
+ * there, and the swap slot is freed as soon as the page is mapped.  Read
+ * such pages synchronously into a private page instead.
+ *
+ * Returns the page locked, off the swap cache, with SWAP_HAS_CACHE still
+ * held on @entry to keep others from reading it into the swap cache in
+ * the meantime; the caller must drop it with swapcache_free().  Returns
+ * NULL if the swap cache should be used.
+ */
+struct page *swapin_skip_swapcache(swp_entry_t entry,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct swap_info_struct *si = swp_swap_info(entry);
+	struct page *page;
+
+	if (!sysctl_swapin_skip_swapcache || !(si->flags & SWP_FAST))
+		return NULL;
+	if (swapcache_prepare(entry))
+		return NULL;
+	if (swp_swapcount(entry) != 1)
+		goto out;
+
+	page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, addr);
+	if (!page)
+		goto out;
+
+	__set_page_locked(page);
+	SetPageSwapBacked(page);
+	set_page_private(page, entry.val);
+	lru_cache_add_anon(page);
+	swap_readpage(page);
+	lock_page(page);
+	set_page_private(page, 0);
+	count_vm_event(SWAPIN_SKIP_CACHE);
+	return page;
+out:
+	swapcache_free(entry, NULL);
+	return NULL;
+}
@@ -1465,14 +1465,16 @@ static void __vunmap(const void *addr, int deallocate_pages)
 	debug_check_no_obj_freed(addr, area->size);
 
 	if (deallocate_pages) {
+		LIST_HEAD(pages);
 		int i;
 
 		for (i = 0; i < area->nr_pages; i++) {
 			struct page *page = area->pages[i];
 
 			BUG_ON(!page);
-			__free_page(page);
+			list_add_tail(&page->lru, &pages);
 		}
+		free_pages_bulk(&pages);
 
 		if (area->flags & VM_VPAGES)
 			vfree(area->pages);
@@ -1586,14 +1588,28 @@ static void *__vmalloc_area_node(struct vm_struct *area, gfp_t gfp_mask,
 		return NULL;
 	}
 
-	for (i = 0; i < area->nr_pages; i++) {
+	if (node < 0) {
+		struct page *page, *next;
+		LIST_HEAD(list);
+
+		alloc_pages_bulk(gfp_mask | __GFP_NOWARN, nr_pages, &list);
+		i = 0;
+		list_for_each_entry_safe(page, next, &list, lru) {
+			list_del(&page->lru);
+			area->pages[i++] = page;
+		}
+		if (unlikely(i < nr_pages)) {
+			/* Successfully allocated i pages, free them in __vunmap() */
+			area->nr_pages = i;
+			goto fail;
+		}
+	}
+
+	for (i = 0; node >= 0 && i < area->nr_pages; i++) {
 		struct page *page;
 		gfp_t tmp_mask = gfp_mask | __GFP_NOWARN;
 
-		if (node < 0)
-			page = alloc_page(tmp_mask);
-		else
-			page = alloc_pages_node(node, tmp_mask, order);
+		page = alloc_pages_node(node, tmp_mask, order);
 
 		if (unlikely(!page)) {
 			/* Successfully allocated i pages, free them in __vunmap() */
@@ -744,6 +744,10 @@ const char * const vmstat_text[] = {
 
 #ifdef CONFIG_NUMA
 	"zone_reclaim_failed",
+#endif
+#ifdef CONFIG_PROCESS_RECLAIM
+	"pgscan_process",
+	"pgsteal_process",
 #endif
 	"pginodesteal",
 	"slabs_scanned",
@@ -765,6 +769,8 @@ const char * const vmstat_text[] = {
 	"compact_fail",
 	"compact_success",
 	"compact_retry_success",
+	"compact_daemon_wake",
+	"compact_daemon_success",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -788,6 +794,18 @@ const char * const vmstat_text[] = {
 	"thp_split",
 #endif
 
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+	"swapin_skip_cache",
+#endif
+
+#ifdef CONFIG_READAHEAD_HISTORY
+	"ra_history_replay",
+	"ra_history_pages",
+	"ra_history_miss",
+#endif
+
 #endif /* CONFIG_VM_EVENTS_COUNTERS */
 };
 #endif /* CONFIG_PROC_FS || CONFIG_SYSFS */